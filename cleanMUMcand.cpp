@@ -8,9 +8,15 @@
 
 //\Ignore{
 
+#include <string.h>
+#include <omp.h>
+#include <vector>
+#include <algorithm>
 #include "types.h"
+#include "spacedef.h"
 #include "mumcand.h"
 #include "protodef.h"
+#include "minmax.h"
 
 //}
 
@@ -21,32 +27,124 @@
 */
 
 /*
-  The following function compares two MUM-candidates. The MUM-candidate
+  The following class compares two MUM-candidates. The MUM-candidate
   with smaller \texttt{dbstart}-value comes first.
   If both MUMs have the same \texttt{dbstart}-value, then the MUM-candidate
   with the larger length comes first.
 */
 
-static Sint compareMUMcandidates(MUMcandidate *p,MUMcandidate *q)
+struct ByMUMstart
 {
-  if(p->dbstart == q->dbstart)
+  bool operator()(const MUMcandidate &p,const MUMcandidate &q) const
   {
-    return (p->mumlength < q->mumlength) ? 1 : -1;
+    if(p.dbstart == q.dbstart)
+    {
+      return p.mumlength > q.mumlength;
+    }
+    return p.dbstart < q.dbstart;
   }
-  return (p->dbstart > q->dbstart) ? 1 : -1;
-}
+};
 
 /*
   Sort all MUM-candidates according by increasing \texttt{dbstart}-value
-  and decreasing length.
+  and decreasing length. The table is split into one range per thread.
+  The ranges are sorted in parallel and then merged pairwise, where the
+  merges of one round are done in parallel.
 */
 
 static void sortMUMcandidates(ArrayMUMcandidate *mumcand)
 {
-  qsort(mumcand->spaceMUMcandidate,
-        (size_t) mumcand->nextfreeMUMcandidate,
-        sizeof(MUMcandidate),
-        (Qsortcomparefunction) compareMUMcandidates);
+  MUMcandidate *space = mumcand->spaceMUMcandidate;
+  Uint range, width, numofranges = MIN((Uint) omp_get_max_threads(),
+                                       mumcand->nextfreeMUMcandidate);
+  vector<Uint> bounds(numofranges+1);
+
+  for(range = 0; range <= numofranges; range++)
+  {
+    bounds[range] = (Uint) ((double) mumcand->nextfreeMUMcandidate * 
+                            range / numofranges);
+  }
+#pragma omp parallel for schedule(static,1)
+  for(Uint r = 0; r < numofranges; r++)
+  {
+    sort(space + bounds[r],space + bounds[r+1],ByMUMstart());
+  }
+  for(width = UintConst(1); width < numofranges; width *= 2)
+  {
+#pragma omp parallel for schedule(dynamic,1)
+    for(Uint r = 0; r < numofranges; r += 2*width)
+    {
+      if(r + width < numofranges)
+      {
+        inplace_merge(space + bounds[r],space + bounds[r+width],
+                      space + bounds[MIN(r+2*width,numofranges)],
+                      ByMUMstart());
+      }
+    }
+  }
+}
+
+/*
+  After sorting, a MUM-candidate is ignored if its right end is not 
+  larger than the right ends of all previous MUM-candidates, and if the
+  next MUM-candidate has the same start and ends at the right end of
+  all MUM-candidates up to the next one. So the decision only depends
+  on the maximal right end of the previous MUM-candidates. The sorted 
+  table is split into ranges. At first the maximal right end of each 
+  range is determined in parallel. The maximal right end before a range
+  is then obtained as the maximum over the previous ranges. Given this
+  value, the ranges are swept in parallel, where the last MUM-candidate
+  of a range looks ahead at the first MUM-candidate of the next range.
+  The decisions are stored in \texttt{ismum}.
+*/
+
+static void markuniqueMUMcandidates(ArrayMUMcandidate *mumcand,
+                                    vector<Uchar> &ismum)
+{
+  MUMcandidate *space = mumcand->spaceMUMcandidate;
+  Uint range, numofmumcands = mumcand->nextfreeMUMcandidate,
+       numofranges = MIN((Uint) (4 * omp_get_max_threads()),numofmumcands);
+  vector<Uint> bounds(numofranges+1), rangeright(numofranges+1,0);
+
+  for(range = 0; range <= numofranges; range++)
+  {
+    bounds[range] = (Uint) ((double) numofmumcands * range / numofranges);
+  }
+#pragma omp parallel for schedule(static)
+  for(Uint r = 0; r < numofranges; r++)
+  {
+    Uint i, dbright = 0;
+
+    for(i = bounds[r]; i < bounds[r+1]; i++)
+    {
+      dbright = MAX(dbright,space[i].dbstart + space[i].mumlength - 1);
+    }
+    rangeright[r+1] = dbright;
+  }
+  for(range = 0; range < numofranges; range++)
+  {
+    rangeright[range+1] = MAX(rangeright[range],rangeright[range+1]);
+  }
+#pragma omp parallel for schedule(static)
+  for(Uint r = 0; r < numofranges; r++)
+  {
+    Uint i, currentright, nextright, dbright = rangeright[r];
+
+    for(i = bounds[r]; i < bounds[r+1]; i++)
+    {
+      currentright = space[i].dbstart + space[i].mumlength - 1;
+      ismum[i] = (dbright < currentright) ? 1 : 0;
+      dbright = MAX(dbright,currentright);
+      if(i + 1 < numofmumcands)
+      {
+        nextright = space[i+1].dbstart + space[i+1].mumlength - 1;
+        if(dbright == nextright && space[i+1].dbstart == space[i].dbstart)
+        {
+          ismum[i] = 0;
+        }
+      }
+    }
+  }
 }
 
 /*EE
@@ -63,48 +161,16 @@ Sint mumuniqueinquery(void *processinfo,
 {
   if(mumcand->nextfreeMUMcandidate > 0)
   {
-    Uint currentright, dbright = 0;
+    vector<Uchar> ismum(mumcand->nextfreeMUMcandidate);
     MUMcandidate *mumcandptr;
-    bool ignorecurrent, ignoreprevious = false;
+    Uint i;
 
     sortMUMcandidates(mumcand);
-    for(mumcandptr = mumcand->spaceMUMcandidate;
-        mumcandptr < mumcand->spaceMUMcandidate + 
-                     mumcand->nextfreeMUMcandidate;
-        mumcandptr++)
+    markuniqueMUMcandidates(mumcand,ismum);
+    for(i = 0; i < mumcand->nextfreeMUMcandidate; i++)
     {
-      ignorecurrent = false;
-      currentright = mumcandptr->dbstart + mumcandptr->mumlength - 1;
-      if(dbright > currentright)
-      {
-        ignorecurrent = true;
-      } else
-      {
-        if(dbright == currentright)
-        {
-          ignorecurrent = true;
-          if(!ignoreprevious && (mumcandptr-1)->dbstart == mumcandptr->dbstart)
-          {
-            ignoreprevious = true;
-          }
-        } else
-        {
-          dbright = currentright;
-        }
-      }
-      if(mumcandptr > mumcand->spaceMUMcandidate && !ignoreprevious)
-      {
-        if(processmum(processinfo, (mumcandptr-1)->mumlength, (mumcandptr-1)->dbstart, (mumcandptr-1)->queryseq, (mumcandptr-1)->querystart) != 0)
-        {
-          return -1;
-        }
-      }
-      ignoreprevious = ignorecurrent;
-    }
-    if(!ignoreprevious)
-    {
-      mumcandptr = mumcand->spaceMUMcandidate + mumcand->nextfreeMUMcandidate - 1;
-      if(processmum(processinfo, mumcandptr->mumlength, mumcandptr->dbstart, mumcandptr->queryseq, mumcandptr->querystart) != 0)
+      mumcandptr = mumcand->spaceMUMcandidate + i;
+      if(ismum[i] && processmum(processinfo, mumcandptr->mumlength, mumcandptr->dbstart, mumcandptr->queryseq, mumcandptr->querystart) != 0)
       {
         return -1;
       }
@@ -112,3 +178,44 @@ Sint mumuniqueinquery(void *processinfo,
   }
   return 0;
 }
+
+/*EE
+  The MUM-candidates are stored by each thread in its own table, so
+  that no synchronization is required. The following function appends
+  the \texttt{numofthreads} tables \texttt{threadmumcand} to the table
+  \texttt{mumcand} in parallel, and declares them to be empty.
+*/
+
+void collectMUMcandidates(ArrayMUMcandidate *mumcand,
+                          ArrayMUMcandidate *threadmumcand,
+                          Uint numofthreads)
+{
+  vector<Uint> offsets(numofthreads+1);
+  Uint thread;
+
+  offsets[0] = mumcand->nextfreeMUMcandidate;
+  for(thread = 0; thread < numofthreads; thread++)
+  {
+    offsets[thread+1] = offsets[thread] + 
+                        threadmumcand[thread].nextfreeMUMcandidate;
+  }
+  if(offsets[numofthreads] == mumcand->nextfreeMUMcandidate)
+  {
+    return;
+  }
+  CHECKARRAYSPACEMULTI(mumcand,MUMcandidate,
+                       offsets[numofthreads] - mumcand->nextfreeMUMcandidate);
+#pragma omp parallel for schedule(static,1)
+  for(Uint t = 0; t < numofthreads; t++)
+  {
+    if(threadmumcand[t].nextfreeMUMcandidate > 0)
+    {
+      memcpy(mumcand->spaceMUMcandidate + offsets[t],
+             threadmumcand[t].spaceMUMcandidate,
+             (size_t) threadmumcand[t].nextfreeMUMcandidate * 
+                      sizeof(MUMcandidate));
+      threadmumcand[t].nextfreeMUMcandidate = 0;
+    }
+  }
+  mumcand->nextfreeMUMcandidate = offsets[numofthreads];
+}
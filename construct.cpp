@@ -15,6 +15,7 @@
 #include <string.h>
 #include <assert.h>
 #include "intbits.h"
+#include "minmax.h"
 #include "spacedef.h"
 #include "streedef.h"
 #include "streeacc.h"
@@ -62,6 +63,14 @@
  the branching nodes. This usually suffices for most cases. In case we need 
  more integers, we allocate space for \(\texttt{ADDFACTOR}\cdot n\) 
  (at least 16) extra branching nodes. 
+ Since a suffix tree for a string of length \(n\) has at most \(n\)
+ branching nodes besides the root, \(\texttt{MAXBRANCHTABSIZE}(n)\) 
+ integers always suffice, but not less than the initial amount
+ for \(\texttt{MINEXTRA}\) nodes, which is allocated even for a very
+ short string. We reserve this amount of address space
+ once, so that enlarging the table only commits more of the reserved
+ pages and never copies the table. If the address space cannot be
+ reserved, we fall back to enlarging the table by reallocation.
 */
 
 #ifndef STARTFACTOR
@@ -71,11 +80,16 @@
 #define ADDFACTOR   0.05
 #define MINEXTRA    16
 
+#define MAXBRANCHTABSIZE(N)  MAX(LARGEINTS * ((N) + 2),\
+                                 MULTBYSMALLINTS(MINEXTRA))
+
 
 /*
  Before a new node is stored, we check if there is enough space available.
  If not, the space is enlarged by a small amount. Since some global pointers
  directly refer into the table, these have to be adjusted after reallocation.
+ If the table lives in reserved address space, it does not move and the
+ pointers remain unchanged.
 */
 
 static void spaceforbranchtab(Suffixtree *stree)
@@ -90,6 +104,10 @@ static void spaceforbranchtab(Suffixtree *stree)
       extra = MULTBYSMALLINTS(MINEXTRA);
     }
     stree->currentbranchtabsize += extra;
+    if(stree->currentbranchtabsize > MAXBRANCHTABSIZE(stree->textlen))
+    {
+      stree->currentbranchtabsize = MAXBRANCHTABSIZE(stree->textlen);
+    }
     tmpheadnode = BRADDR2NUM(stree,stree->headnode);
     if(stree->chainstart != NULL)
     {
@@ -613,7 +631,9 @@ static void initSuffixtree(Suffixtree *stree,Uchar *text,Uint textlen)
   }
   stree->leaftab = ALLOCSPACE(NULL,Uint,textlen+2);
   stree->rootchildren = ALLOCSPACE(NULL,Uint,LARGESTCHARINDEX + 1);
-  stree->branchtab = ALLOCSPACE(NULL,Uint,stree->currentbranchtabsize);
+  stree->branchtab = RESERVESPACE(Uint,MAXBRANCHTABSIZE(textlen));
+  stree->branchtab 
+    = ALLOCSPACE(stree->branchtab,Uint,stree->currentbranchtabsize);
 
   stree->text = stree->tailptr = text;
   stree->textlen = textlen;
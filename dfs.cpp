@@ -10,6 +10,7 @@
 #include "spacedef.h"
 #include "streedef.h"
 #include "streeacc.h"
+#include "streedfs.h"
 #include "protodef.h"
 
 #define SETCURRENT(V)\
@@ -216,23 +217,181 @@ while(true)
   return 0;
 }
 
-static Sint insertinleaflist(Uint leafindex,/*@unused@*/ Bref lcpnode,
-                             void *info)
+/*
+  The following class appends the index of each leaf visited to 
+  \texttt{leaflist}.
+*/
+
+struct Insertinleaflist
 {
-  ArrayUint *leaflist = (ArrayUint *) info;
+  ArrayUint *leaflist;
+  Sint operator()(Uint leafindex,/*@unused@*/ Bref lcpnode) const
+  {
+    CHECKARRAYSPACE(leaflist,Uint,256);
+    leaflist->spaceUint[leaflist->nextfreeUint++] = leafindex;
+    return 0;
+  }
+};
 
-  fprintf(stderr,"insertinleaflist %lu\n",(long unsigned int) leafindex);
-  CHECKARRAYSPACE(leaflist,Uint,256);
-  leaflist->spaceUint[leaflist->nextfreeUint++] = leafindex;
-  return 0;
-}
+/*
+  The following function appends the indices of all leaves below
+  \texttt{start} to \texttt{leaflist}, in lexicographic order of the
+  corresponding suffixes.
+*/
 
 Sint makeleaflist(Suffixtree *stree,ArrayUint *leaflist,Reference *start)
 {
-  if(depthfirststree(stree,start,insertinleaflist,NULL,NULL,
-                     NULL,NULL,(void *) leaflist) != 0)
+  ArrayBref stack;
+  Insertinleaflist leaf = {leaflist};
+  Dfsgodown branch1;
+  Dfsnothing branch2;
+  Sint retcode;
+
+  INITARRAY(&stack,Bref);
+  retcode = depthfirsttraversal(stree,start,&stack,leaf,branch1,branch2);
+  FREEARRAY(&stack,Bref);
+  return (retcode != 0) ? -1 : 0;
+}
+
+/*
+  The following classes compute the number of leaves below each 
+  branching node in a depth first traversal. \texttt{counts} is a stack
+  containing for each branching node on the current path the number of 
+  leaves visited below it so far. When a branching node has been 
+  processed, its number of leaves is stored in \texttt{leafcounts} at 
+  the index of its head position, and is added to the count of its 
+  father.
+*/
+
+struct Leafcountleaf
+{
+  ArrayUint *counts;
+  Sint operator()(/*@unused@*/ Uint leafindex,/*@unused@*/ Bref lcpnode) const
   {
-    return -1;
+    counts->spaceUint[counts->nextfreeUint-1]++;
+    return 0;
+  }
+};
+
+struct Leafcountbranch1
+{
+  ArrayUint *counts;
+  bool operator()(/*@unused@*/ Bref nodeptr) const
+  {
+    STOREINARRAY(counts,Uint,128,0);
+    return true;
+  }
+};
+
+static void setleafcount(Suffixtree *stree,Bref nodeptr,Uint count)
+{
+  Uint headposition, distance, *largeptr;
+
+  GETONLYHEADPOS(headposition,nodeptr);
+  stree->leafcounts[headposition] = count;
+}
+
+struct Leafcountbranch2
+{
+  Suffixtree *stree;
+  ArrayUint *counts;
+  Sint operator()(Bref nodeptr) const
+  {
+    Uint count = counts->spaceUint[--counts->nextfreeUint];
+
+    setleafcount(stree,nodeptr,count);
+    counts->spaceUint[counts->nextfreeUint-1] += count;
+    return 0;
+  }
+};
+
+/*
+  The following function counts the leaves below the branching node
+  \texttt{nodeptr} and all branching nodes in its subtree. Up to
+  nesting level \texttt{maxlevel}, the subtrees of the branching children
+  are counted by separate tasks. Below, the subtree is counted by a 
+  sequential depth first traversal. The number of leaves is returned.
+*/
+
+static Uint countleaves(Suffixtree *stree,Bref nodeptr,Uint level,
+                        Uint maxlevel)
+{
+  Uint child, i, count = 0;
+
+  if(level >= maxlevel)
+  {
+    ArrayBref stack;
+    ArrayUint counts;
+    Reference startnode;
+    Leafcountleaf leaf = {&counts};
+    Leafcountbranch1 branch1 = {&counts};
+    Leafcountbranch2 branch2 = {stree,&counts};
+
+    startnode.address = nodeptr;
+    startnode.toleaf = false;
+    INITARRAY(&stack,Bref);
+    INITARRAY(&counts,Uint);
+    STOREINARRAY(&counts,Uint,128,0);
+    (void) depthfirsttraversal(stree,&startnode,&stack,leaf,branch1,branch2);
+    count = counts.spaceUint[0];
+    FREEARRAY(&counts,Uint);
+    FREEARRAY(&stack,Bref);
+  } else
+  {
+    vector<Bref> branchchildren;
+
+    for(child = GETCHILD(nodeptr); !NILPTR(child); 
+        child = ISLEAF(child) ? LEAFBROTHERVAL(stree->leaftab[GETLEAFINDEX(child)])
+                              : GETBROTHER(stree->branchtab + 
+                                           GETBRANCHINDEX(child)))
+    {
+      if(ISLEAF(child))
+      {
+        count++;
+      } else
+      {
+        branchchildren.push_back(stree->branchtab + GETBRANCHINDEX(child));
+      }
+    }
+    vector<Uint> childcounts(branchchildren.size());
+    for(i = 0; i < (Uint) branchchildren.size(); i++)
+    {
+#pragma omp task firstprivate(i) shared(branchchildren,childcounts)
+      childcounts[i] = countleaves(stree,branchchildren[i],level+1,maxlevel);
+    }
+#pragma omp taskwait
+    for(i = 0; i < (Uint) childcounts.size(); i++)
+    {
+      count += childcounts[i];
+    }
+  }
+  setleafcount(stree,nodeptr,count);
+  return count;
+}
+
+/*
+  The following function allocates the table \texttt{leafcounts} and 
+  stores in it the number of leaves below each branching node, at the 
+  index of its head position. The subtrees are counted in parallel by
+  tasks, which are nested in at most as many levels as in
+  \texttt{parallelsubtreeenumeration}.
+*/
+
+void computeleafcounts(Suffixtree *stree)
+{
+  Uint maxlevel = 0;
+
+  if(stree->leafcounts == NULL)
+  {
+    stree->leafcounts = ALLOCSPACE(NULL,Uint,stree->textlen+1);
+  }
+  while((UintConst(1) << maxlevel) < (Uint) (32 * omp_get_max_threads()))
+  {
+    maxlevel++;
+  }
+#pragma omp parallel
+  {
+#pragma omp single
+    (void) countleaves(stree,ROOT(stree),0,maxlevel);
   }
-  return 0;
 }
@@ -24,15 +24,18 @@
 #include <vector>
 #include <iostream>
 #include <assert.h>
+#include <omp.h>
 #include "types.h"
 #include "intbits.h"
 #include "visible.h"
 #include "streedef.h"
 #include "streeacc.h"
+#include "streedfs.h"
 #include "protodef.h"
 #include "spacedef.h"
 #include "maxmatdef.h"
 #include "distribute.h"
+#include "minmax.h"
 
 Uint encoding(Uchar *example, int wordsize) 
 {
@@ -43,19 +46,19 @@ Uint encoding(Uchar *example, int wordsize)
         {
             case 'A':
             case 'a':
-                encoded &= ~(1<<(j)); encoded &= ~(1<<(j-1)); //00
+                encoded &= ~(UintConst(1)<<(j)); encoded &= ~(UintConst(1)<<(j-1)); //00
                 break;
             case 'C':
             case 'c':
-                encoded &= ~(1<<(j)); encoded |= (1<<(j-1)); //01
+                encoded &= ~(UintConst(1)<<(j)); encoded |= (UintConst(1)<<(j-1)); //01
                 break;
             case 'G':
             case 'g':
-                encoded |= (1<<(j)); encoded &= ~(1<<(j-1)); //10
+                encoded |= (UintConst(1)<<(j)); encoded &= ~(UintConst(1)<<(j-1)); //10
                 break;
             case 'T':
             case 't':
-                encoded |= (1<<(j)); encoded |= (1<<(j-1)); //11
+                encoded |= (UintConst(1)<<(j)); encoded |= (UintConst(1)<<(j-1)); //11
                 break;
             default:
                 break;
@@ -64,93 +67,494 @@ Uint encoding(Uchar *example, int wordsize)
     return encoded;
 }
 
+/*
+ * The following class is applied to each leaf during the traversal in
+ * fillTable. The leaf is stored in the bucket of its first wordsize
+ * characters, together with the depth of its father. Suffixes shorter 
+ * than wordsize cannot start a match of length wordsize and are not 
+ * stored.
+ */
+struct Tableentry
+{
+  Uint code;
+  suffix suf;
+};
+
+struct Maketableentry
+{
+  Suffixtree *stree;
+  Uint wordsize;
+  bool operator()(Uint leafindex, Bref father, Tableentry *entry) const
+  {
+    Uint *largeptr, distance, depth;
+
+    if (leafindex + wordsize > stree->textlen)
+        return false;
+    GETONLYDEPTH(depth,father);
+    entry->code = encoding(stree->text+leafindex,(int) wordsize);
+    entry->suf.depth = depth;
+    entry->suf.position = leafindex;
+    return true;
+  }
+};
+
+/*
+ * The following class collects the entries in lexicographic order and
+ * counts the number of entries of each code.
+ */
+struct Collecttableentry
+{
+  vector<Tableentry> *entries;
+  Table *table;
+  void operator()(Tableentry &entry)
+  {
+    table->offsets[entry.code+1]++;
+    entries->push_back(entry);
+  }
+};
+
+/*
+ * The following function delivers the length of the longest common prefix
+ * of the suffixes at position1 and position2, but at most maxlcp.
+ */
+static Uint suffixlcp(Suffixtree *stree, Uint position1, Uint position2, Uint maxlcp)
+{
+    Uchar *ptr1 = stree->text + position1, *ptr2 = stree->text + position2,
+          *end = stree->text + stree->textlen;
+    Uint length = 0;
+
+    while (length < maxlcp && ptr1 < end && ptr2 < end && *ptr1 == *ptr2)
+    {
+        ptr1++;
+        ptr2++;
+        length++;
+    }
+    return length;
+}
+
 /* 
  * ===  FUNCTION  ======================================================================
- *         Name:  splitsubstreeH
- *  Description:  Traverse every branch of suffix tree and it stops when it
- *  reaches the max characters to save in table.
+ *         Name:  fillTable
+ *  Description:  Enumerate the leaves below startnode in parallel and store
+ *  every leaf in the bucket of its first wordsize characters. The buckets
+ *  are filled by a counting sort of the leaves. Since the leaves arrive in
+ *  lexicographic order, each bucket is sorted. The longest common prefixes
+ *  of neighboring suffixes in a bucket are computed up to length maxlcp.
  * =====================================================================================
  */
-void fillTable(Suffixtree *stree, Table& table, Uchar *buffer,Uint *btptr, short int wordsize)
-{
-  Uint *largeptr, *succptr, leafindex, succdepth, succ, depth, headposition, distance, enc;
-  Uchar *ptr, *end;
-  
-  size_t size;
-  int i;
-  suffix tmp;
-  Suffixes s;
-  GETBOTH(depth,headposition,btptr);
-  succ = GETCHILD(btptr);
-  do 
-  { 
-    size = strlen((const char *)buffer);
-    if(ISLEAF(succ))
-    {
-      leafindex = GETLEAFINDEX(succ);
-      if (size < wordsize)
+void fillTable(Suffixtree *stree, Table& table, Reference *startnode, Uint wordsize, Uint maxlcp)
+{
+  Maketableentry makeentry = {stree, wordsize};
+  vector<Tableentry> entries;
+  Collecttableentry collectentry = {&entries, &table};
+  Uint code;
+
+  table.prefix = wordsize;
+  table.numofcodes = UintConst(1) << (2 * wordsize);
+  table.offsets.assign(table.numofcodes+1,0);
+  parallelsubtreeenumeration<Tableentry>(stree,startnode,makeentry,collectentry);
+  for (code = 0; code < table.numofcodes; code++)
+      table.offsets[code+1] += table.offsets[code];
+  {
+    vector<Uint> nextfree(table.offsets.begin(),table.offsets.end()-1);
+
+    table.suffixes.resize(entries.size());
+    for (vector<Tableentry>::iterator e=entries.begin(); e!=entries.end(); ++e)
+        table.suffixes[nextfree[(*e).code]++] = (*e).suf;
+  }
+  vector<Tableentry>().swap(entries);
+#pragma omp parallel for schedule(dynamic,1024)
+  for (code = 0; code < table.numofcodes; code++)
+  {
+      for (Uint i = table.offsets[code]; i < table.offsets[code+1]; i++)
       {
-          for (i=size, ptr=stree->text+depth+leafindex; i < wordsize && ptr<=stree->sentinel; ptr++, i++)
-              buffer[i]=*ptr;
-          buffer[i]='\0';
-          tmp.depth=depth;
-          tmp.position=leafindex;
-          s.push_back(tmp);
-          enc = encoding(buffer,wordsize);
-          if (table.count(enc))
-              table[enc].insert(table[enc].end(),s.begin(),s.end());
-          else
-              table[enc] = s;
+          table.suffixes[i].lcp = (i == table.offsets[code]) ? 0 :
+              suffixlcp(stree,table.suffixes[i-1].position,
+                        table.suffixes[i].position,maxlcp);
       }
-      else
+  }
+} 
+
+/*
+ * The minimizer of a window of window consecutive prefixes of length
+ * wordsize is the leftmost of these prefixes whose code has the smallest
+ * hash value. The codes are hashed by an invertible function, so that
+ * the minimizers are not biased towards prefixes like aaaa. Since the
+ * minimizer only depends on the characters of the window, a match of
+ * length at least wordsize+window-1 contains a window whose minimizer
+ * is at the same offset in both instances of the match.
+ */
+static inline Uint minimizerhash(Uint code, Uint mask)
+{
+    code = (~code + (code << 21)) & mask;
+    code = code ^ (code >> 24);
+    code = ((code + (code << 3)) + (code << 8)) & mask;
+    code = code ^ (code >> 14);
+    code = ((code + (code << 2)) + (code << 4)) & mask;
+    code = code ^ (code >> 28);
+    code = (code + (code << 31)) & mask;
+    return code;
+}
+
+/*
+ * The following function delivers the code of a character like encoding.
+ */
+static inline Uint charcode(Uchar c)
+{
+    switch (c)
+    {
+        case 'C':
+        case 'c':
+            return UintConst(1);
+        case 'G':
+        case 'g':
+            return UintConst(2);
+        case 'T':
+        case 't':
+            return UintConst(3);
+        default:
+            return 0;
+    }
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  minimizerpositions
+ *  Description:  Append the positions of the minimizers of the windows 
+ *  firstwindow to endwindow-1 of seq to positions, where window i consists
+ *  of the prefixes starting at positions i to i+window-1. The positions are
+ *  appended in increasing order, and a minimizer shared by consecutive 
+ *  windows is appended only once. The hash values of the last window 
+ *  prefixes are kept in a ring buffer, which is only rescanned when the
+ *  minimizer leaves the window.
+ * =====================================================================================
+ */
+void minimizerpositions(Uchar *seq, Uint wordsize, Uint window, Uint firstwindow, Uint endwindow, vector<Uint> &positions)
+{
+  Uint mask = (UintConst(1) << (2 * wordsize)) - 1, code = 0, hash,
+       word, minword = firstwindow, minhash = 0, i;
+  vector<Uint> hashes(window);
+
+  if (firstwindow >= endwindow)
+      return;
+  for (i = firstwindow; i < firstwindow + wordsize - 1; i++)
+      code = ((code << 2) | charcode(seq[i])) & mask;
+  for (word = firstwindow; word < endwindow + window - 1; word++)
+  {
+      code = ((code << 2) | charcode(seq[word + wordsize - 1])) & mask;
+      hash = minimizerhash(code,mask);
+      hashes[word % window] = hash;
+      if (word == firstwindow || 
+          (minword + window > word && hash < minhash))
+      {
+          minword = word;
+          minhash = hash;
+      } else
       {
-          tmp.depth=depth;
-          tmp.position=leafindex;
-          s.push_back(tmp);
+          if (minword + window <= word)
+          {
+              minword = word - window + 1;
+              minhash = hashes[minword % window];
+              for (i = minword + 1; i <= word; i++)
+              {
+                  if (hashes[i % window] < minhash)
+                  {
+                      minword = i;
+                      minhash = hashes[i % window];
+                  }
+              }
+          }
       }
-      buffer[size]='\0';
-      succ = LEAFBROTHERVAL(stree->leaftab[leafindex]);
-    } else
-    {
-      succptr = stree->branchtab + GETBRANCHINDEX(succ);
-      if (size < wordsize)
+      if (word + 1 >= firstwindow + window &&
+          (positions.empty() || positions.back() != minword))
+          positions.push_back(minword);
+  }
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  windowminimizer
+ *  Description:  Deliver the offset of the minimizer of the window of 
+ *  window prefixes starting at seq.
+ * =====================================================================================
+ */
+Uint windowminimizer(Uchar *seq, Uint wordsize, Uint window)
+{
+  Uint mask = (UintConst(1) << (2 * wordsize)) - 1, code = 0, hash,
+       minword = 0, minhash = 0, i;
+
+  for (i = 0; i < wordsize - 1; i++)
+      code = ((code << 2) | charcode(seq[i])) & mask;
+  for (i = 0; i < window; i++)
+  {
+      code = ((code << 2) | charcode(seq[i + wordsize - 1])) & mask;
+      hash = minimizerhash(code,mask);
+      if (i == 0 || hash < minhash)
       {
-          GETBOTH(succdepth,headposition,succptr);
-          end=stree->text + depth + headposition + succdepth - depth - 1;
-          for (i=size, ptr=stree->text+depth+headposition; i < wordsize &&  ptr<=end; ptr++, i++)
-              buffer[i]=*ptr;
-          buffer[i]='\0';
+          minword = i;
+          minhash = hash;
       }
-      fillTable(stree,table,buffer,succptr,wordsize);
-      buffer[size]='\0';
-      succ = GETBROTHER(succptr);
-    }  
-   } while(!NILPTR(succ));
-   enc = encoding(buffer,wordsize);
-   if (table.count(enc))
-       table[enc].insert(table[enc].end(),s.begin(),s.end());
-   else
-       table[enc] = s;
-} 
+  }
+  return minword;
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fillSampledTable
+ *  Description:  Store the suffixes starting at the positions in 
+ *  blockpositions in the table, where the positions of each block are
+ *  in increasing order, and all positions of a block are smaller than 
+ *  those of the next block. The depth and the lcp of the suffixes are not 
+ *  computed. The space for the positions is freed.
+ * =====================================================================================
+ */
+void fillSampledTable(Uchar *text, Table& table, Uint wordsize, vector< vector<Uint> > &blockpositions)
+{
+  Uint code, numofpositions = 0;
+
+  table.prefix = wordsize;
+  table.numofcodes = UintConst(1) << (2 * wordsize);
+  table.offsets.assign(table.numofcodes+1,0);
+  for (Uint block = 0; block < (Uint) blockpositions.size(); block++)
+  {
+      for (vector<Uint>::iterator p=blockpositions[block].begin(); 
+           p!=blockpositions[block].end(); ++p)
+          table.offsets[encoding(text+*p,(int) wordsize)+1]++;
+      numofpositions += blockpositions[block].size();
+  }
+  for (code = 0; code < table.numofcodes; code++)
+      table.offsets[code+1] += table.offsets[code];
+  {
+    vector<Uint> nextfree(table.offsets.begin(),table.offsets.end()-1);
+
+    table.suffixes.resize(numofpositions);
+    for (Uint block = 0; block < (Uint) blockpositions.size(); block++)
+    {
+        for (vector<Uint>::iterator p=blockpositions[block].begin(); 
+             p!=blockpositions[block].end(); ++p)
+        {
+            suffix *suf = &table.suffixes[nextfree[encoding(text+*p,(int) wordsize)]++];
+
+            suf->depth = 0;
+            suf->position = *p;
+            suf->lcp = 0;
+        }
+        vector<Uint>().swap(blockpositions[block]);
+    }
+  }
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fillCodedTable
+ *  Description:  Store the suffixes of the pairs in blocksamples in the 
+ *  table, where uint0 of a pair is the code of the first wordsize 
+ *  characters of the suffix and uint1 its position. The pairs of each
+ *  block are sorted by their codes, and the pairs with the same code by
+ *  their positions, and all positions of a block are smaller than those
+ *  of the next block. So the buckets are the same as delivered by 
+ *  fillSampledTable for these positions, but the text is not read and
+ *  the suffixes of each block are written in order of the buckets. The 
+ *  space for the pairs is freed.
+ * =====================================================================================
+ */
+void fillCodedTable(Table& table, Uint wordsize, vector< vector<PairUint> > &blocksamples)
+{
+  Uint code, numofpositions = 0;
+
+  table.prefix = wordsize;
+  table.numofcodes = UintConst(1) << (2 * wordsize);
+  table.offsets.assign(table.numofcodes+1,0);
+  for (Uint block = 0; block < (Uint) blocksamples.size(); block++)
+  {
+      for (vector<PairUint>::iterator p=blocksamples[block].begin(); 
+           p!=blocksamples[block].end(); ++p)
+          table.offsets[p->uint0+1]++;
+      numofpositions += blocksamples[block].size();
+  }
+  for (code = 0; code < table.numofcodes; code++)
+      table.offsets[code+1] += table.offsets[code];
+  {
+    vector<Uint> nextfree(table.offsets.begin(),table.offsets.end()-1);
 
+    table.suffixes.resize(numofpositions);
+    for (Uint block = 0; block < (Uint) blocksamples.size(); block++)
+    {
+        for (vector<PairUint>::iterator p=blocksamples[block].begin(); 
+             p!=blocksamples[block].end(); ++p)
+        {
+            suffix *suf = &table.suffixes[nextfree[p->uint0]++];
+
+            suf->depth = 0;
+            suf->position = p->uint1;
+            suf->lcp = 0;
+        }
+        vector<PairUint>().swap(blocksamples[block]);
+    }
+  }
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  minimizerblocks
+ *  Description:  Deliver the minimizers of the windows of window prefixes
+ *  of length wordsize of text in blockpositions, in increasing order of 
+ *  their positions. The windows are split into blocks whose minimizers
+ *  are computed in parallel. A minimizer shared by the last window of a 
+ *  block and the first window of the next block is delivered once. 
+ * =====================================================================================
+ */
+void minimizerblocks(Uchar *text, Uint textlen, Uint wordsize, Uint window, vector< vector<Uint> > &blockpositions)
+{
+  Uint numofwindows = 0, numofblocks;
+
+  if (textlen + 1 >= wordsize + window)
+      numofwindows = textlen + 2 - wordsize - window;
+  numofblocks = MIN((Uint) (4 * omp_get_max_threads()),numofwindows);
+  blockpositions.assign(numofblocks,vector<Uint>());
+#pragma omp parallel for schedule(dynamic,1)
+  for (Uint block = 0; block < numofblocks; block++)
+  {
+      minimizerpositions(text,wordsize,window,
+                         (Uint) ((double) numofwindows * block / numofblocks),
+                         (Uint) ((double) numofwindows * (block+1) / numofblocks),
+                         blockpositions[block]);
+  }
+  for (Uint block = 1; block < numofblocks; block++)
+  {
+      if (!blockpositions[block].empty() && 
+          !blockpositions[block-1].empty() &&
+          blockpositions[block][0] == blockpositions[block-1].back())
+          blockpositions[block].erase(blockpositions[block].begin());
+  }
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fillMinimizerTable
+ *  Description:  Store only the minimizers of the windows of window 
+ *  prefixes of length wordsize of text in the table, in increasing order
+ *  of their positions.
+ * =====================================================================================
+ */
+void fillMinimizerTable(Uchar *text, Uint textlen, Table& table, Uint wordsize, Uint window)
+{
+  vector< vector<Uint> > blockpositions;
+
+  minimizerblocks(text,textlen,wordsize,window,blockpositions);
+  fillSampledTable(text,table,wordsize,blockpositions);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  fillSparseTable
+ *  Description:  Store only the suffixes of text starting at the multiples
+ *  of step in the table, in increasing order of their positions. As in a
+ *  sparse suffix tree, the table needs 1/step of the space.
+ * =====================================================================================
+ */
+void fillSparseTable(Uchar *text, Uint textlen, Table& table, Uint wordsize, Uint step)
+{
+  Uint numofsamples = 0, numofblocks;
+
+  if (textlen >= wordsize)
+      numofsamples = (textlen - wordsize) / step + 1;
+  numofblocks = MIN((Uint) (4 * omp_get_max_threads()),numofsamples);
+  vector< vector<Uint> > blockpositions(numofblocks);
+#pragma omp parallel for schedule(dynamic,1)
+  for (Uint block = 0; block < numofblocks; block++)
+  {
+      for (Uint sample = (Uint) ((double) numofsamples * block / numofblocks);
+           sample < (Uint) ((double) numofsamples * (block+1) / numofblocks);
+           sample++)
+          blockpositions[block].push_back(sample * step);
+  }
+  fillSampledTable(text,table,wordsize,blockpositions);
+}
+
+/* 
+ * ===  FUNCTION  ======================================================================
+ *         Name:  createTable
+ *  Description:  Fill the table with all suffixes of the subject sequence,
+ *  or only with its minimizers if a minimizer window is given, or only 
+ *  with every step-th suffix if a sparse step is given. In the latter two
+ *  cases, the suffix tree is not needed, and the subject sequence may 
+ *  consist of shards whose samples are computed separately. If a bucket cap is given, the 
+ *  buckets exceeding it are counted, since probes hitting them are 
+ *  deferred by findmumcandidates.
+ * =====================================================================================
+ */
 void createTable(Matchprocessinfo *matchprocessinfo) 
- {
-    Uint *largeptr, *btptr, *succptr, *rcptr, i, succdepth, distance, nodeaddress, succ, depth, child, brother, headposition, suffixlink;
-    Uint leafindex, edgelen;
-    Uchar *leftpointer, *buffer;
-    
-    buffer = (Uchar *) malloc(matchprocessinfo->prefix*sizeof(Uchar *));
-    for(rcptr = matchprocessinfo->stree.rootchildren; 
-        rcptr <= matchprocessinfo->stree.rootchildren + LARGESTCHARINDEX;rcptr++)
-     { 
-        if(*rcptr != UNDEFINEDREFERENCE)
+{
+    Reference root;
+    Uint repeatbuckets = 0, repeatsuffixes = 0;
+
+    if (matchprocessinfo->numofshards > 0)
+    {
+        fillShardedTable(matchprocessinfo->stree.text,
+                         matchprocessinfo->table,matchprocessinfo->prefix,
+                         &matchprocessinfo->probeoptions,
+                         matchprocessinfo->shardfilelist,
+                         matchprocessinfo->numofshards,
+                         matchprocessinfo->shardstart,
+                         matchprocessinfo->verbose);
+        if (matchprocessinfo->verbose)
+        {
+            fprintf(stderr,"# %lu sampled suffixes of %lu suffixes in %lu shards stored\n",
+                    (long unsigned int) matchprocessinfo->table.suffixes.size(),
+                    (long unsigned int) matchprocessinfo->stree.textlen,
+                    (long unsigned int) matchprocessinfo->numofshards);
+        }
+        return;
+    }
+    if (matchprocessinfo->probeoptions.minimizerwindow > 0)
+    {
+        fillMinimizerTable(matchprocessinfo->stree.text,
+                           matchprocessinfo->stree.textlen,
+                           matchprocessinfo->table,matchprocessinfo->prefix,
+                           matchprocessinfo->probeoptions.minimizerwindow);
+        if (matchprocessinfo->verbose)
+        {
+            fprintf(stderr,"# %lu minimizers of %lu suffixes stored\n",
+                    (long unsigned int) matchprocessinfo->table.suffixes.size(),
+                    (long unsigned int) matchprocessinfo->stree.textlen);
+        }
+        return;
+    }
+    if (matchprocessinfo->probeoptions.sparsestep > 0)
+    {
+        fillSparseTable(matchprocessinfo->stree.text,
+                        matchprocessinfo->stree.textlen,
+                        matchprocessinfo->table,matchprocessinfo->prefix,
+                        matchprocessinfo->probeoptions.sparsestep);
+        if (matchprocessinfo->verbose)
+        {
+            fprintf(stderr,"# %lu sparse suffixes of %lu suffixes stored\n",
+                    (long unsigned int) matchprocessinfo->table.suffixes.size(),
+                    (long unsigned int) matchprocessinfo->stree.textlen);
+        }
+        return;
+    }
+    root.toleaf = false;
+    root.address = ROOT(&matchprocessinfo->stree);
+    fillTable(&matchprocessinfo->stree,matchprocessinfo->table,&root,
+              matchprocessinfo->prefix,matchprocessinfo->minmatchlength);
+    if (matchprocessinfo->verbose && matchprocessinfo->probeoptions.bucketcap > 0)
+    {
+        Table *table = &matchprocessinfo->table;
+
+        for (Uint code=0; code < table->numofcodes; code++)
         {
-            buffer[0] = (Uchar) (rcptr - matchprocessinfo->stree.rootchildren);
-            buffer[1] = '\0';
-            btptr = matchprocessinfo->stree.branchtab + GETBRANCHINDEX(*rcptr);
-            fillTable(&matchprocessinfo->stree,matchprocessinfo->table,buffer,btptr,matchprocessinfo->prefix);
+            if (BUCKETSIZE(table,code) > matchprocessinfo->probeoptions.bucketcap)
+            {
+                repeatbuckets++;
+                repeatsuffixes += BUCKETSIZE(table,code);
+            }
         }
-    } 
+        fprintf(stderr,"# %lu buckets with %lu suffixes exceed the bucket cap %lu\n",
+                (long unsigned int) repeatbuckets,(long unsigned int) repeatsuffixes,
+                (long unsigned int) matchprocessinfo->probeoptions.bucketcap);
+    }
 }
 
 /* Reallocate memory for  Q  to  Len  bytes and return a
@@ -20,8 +20,16 @@
 #include "streetyp.h"
 #include "maxmatdef.h"
 
-void fillTable(Suffixtree *stree,Table& table,Uchar *buffer,Uint *btptr, short int wordsize);
+void fillTable(Suffixtree *stree,Table& table,Reference *startnode,Uint wordsize,Uint maxlcp);
 Uint encoding(Uchar *example, int wordsize);
+void minimizerpositions(Uchar *seq,Uint wordsize,Uint window,Uint firstwindow,Uint endwindow,vector<Uint> &positions);
+Uint windowminimizer(Uchar *seq,Uint wordsize,Uint window);
+void fillSampledTable(Uchar *text,Table& table,Uint wordsize,vector< vector<Uint> > &blockpositions);
+void fillCodedTable(Table& table,Uint wordsize,vector< vector<PairUint> > &blocksamples);
+void minimizerblocks(Uchar *text,Uint textlen,Uint wordsize,Uint window,vector< vector<Uint> > &blockpositions);
+void fillMinimizerTable(Uchar *text,Uint textlen,Table& table,Uint wordsize,Uint window);
+void fillSparseTable(Uchar *text,Uint textlen,Table& table,Uint wordsize,Uint step);
+void fillShardedTable(Uchar *text,Table& table,Uint wordsize,Probeoptions *probeoptions,char **shardfilelist,Uint numofshards,Uint *shardstart,bool verbose);
 void createTable(Matchprocessinfo *matchprocessinfo);
 void *Safe_realloc  (void * Q, size_t Len);
 void *Safe_malloc  (size_t Len);
@@ -12,42 +12,18 @@
 #include <ctype.h>
 #include <omp.h>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 #include "distribute.h"
 #include "streedef.h"
 #include "streeacc.h"
+#include "streedfs.h"
 #include "spacedef.h"
 #include "maxmatdef.h"
+#include "minmax.h"
 
 //}
 
-#define LEASTSHOWPROGRESS 100000
-#define NUMOFCALLS 100
-
-#define DECLAREEXTRA\
-        Uint j = 0, step, nextstep;\
-        stree->nonmaximal = NULL;\
-        step = querylen/NUMOFCALLS;\
-        nextstep = (querylen >= LEASTSHOWPROGRESS) ? step : (querylen+1);\
-        if(querylen >= LEASTSHOWPROGRESS)\
-        {\
-          fprintf(stderr,"# process %lu characters per dot\n",\
-                 (Uint) querylen/NUMOFCALLS);\
-        }\
-        fprintf(stderr,"#....................................................................................................\n");
-
-#define CHECKSTEP            if(j == nextstep)\
-                             {\
-                                 if(nextstep == step)\
-                                 {\
-                                   fputc('#',stderr);\
-                                 }\
-                                 fputc('.',stderr);\
-                                 fflush(stdout);\
-                               nextstep += step;\
-                             }\
-                             j++
-
-
 /*EE
   This file contains functions to compute maximal matches of some
   minimum length between the subject-sequence and the query-sequence.
@@ -114,6 +90,7 @@ struct Maxmatchinfo
   Suffixtree *stree;              // reference to suffix tree of subject-seq
   ArrayNodeinfo commondepthstack; // stack to store depth values
   ArrayPathinfo matchpath;        // path of br. nodes from ploc to maxloc
+  ArrayBref dfsstack;             // stack for the depth first traversal
   Location maxloc;                // location of \texttt{pmax}
   Uchar *query,                   // the query string
         *querysuffix;             // current suffix of query
@@ -121,6 +98,7 @@ struct Maxmatchinfo
        queryseqnum,               // number of query sequence
        minmatchlength,            // min length of a match to be reported
        depthofpreviousmaxloc;     // the depth of the previous maxloc
+  bool uniqueonly;                // only report matches unique in subject
   Processmatchfunction processmatch; // this function processes found match
   void *processinfo;            // first arg. when calling previous function
 };
@@ -155,11 +133,9 @@ struct Maxmatchinfo
   prefix of this suffix and \(s\) is computed.
 */
 
-static Sint processleaf(Uint leafindex,/*@unused@*/ Bref lcpnode,void *info)
+static inline Sint processleaf(Maxmatchinfo *maxmatchinfo,Uint leafindex)
 {
   //fprintf(stderr,"%s Thread:%d\n",__func__, omp_get_thread_num());
-  Maxmatchinfo *maxmatchinfo = (Maxmatchinfo *) info;
-
   if(leafindex == 0 ||
      maxmatchinfo->query == maxmatchinfo->querysuffix ||
      maxmatchinfo->stree->text[leafindex - 1] != 
@@ -255,9 +231,8 @@ static void inheritfrompath(ArrayPathinfo *matchpath,Location *maxloc,Nodeinfo *
   The following function is called whenever during a depth first traversal
   of a subtree of the suffix tree, each time
   a branching node is visited for the first time.
-  The arguments are the branching node \texttt{nodeptr} and 
-  a pointer \texttt{info} to some information passed to the function 
-  \texttt{depthfirststree}. If the \texttt{commondepthstack}
+  The arguments are the information about the current computation
+  and the branching node \texttt{nodeptr}. If the \texttt{commondepthstack}
   is empty or the father of the current node is on the maximal path,
   then the commondepthstack inherits information from the appropriate
   value of the maximal match path. Otherwise, the information about
@@ -266,9 +241,8 @@ static void inheritfrompath(ArrayPathinfo *matchpath,Location *maxloc,Nodeinfo *
   traversal continues.
 */
 
-static bool processbranch1(Bref nodeptr,void *info)
+static inline bool processbranch1(Maxmatchinfo *maxmatchinfo,Bref nodeptr)
 {
-  Maxmatchinfo *maxmatchinfo = (Maxmatchinfo *) info;
   Nodeinfo *stacktop, 
            *father;
   GETNEXTFREEINARRAY(stacktop,&maxmatchinfo->commondepthstack,Nodeinfo,32);
@@ -295,18 +269,78 @@ static bool processbranch1(Bref nodeptr,void *info)
   \texttt{nodeptr}
   is visited for the second time (i.e.\ the entire subtree below 
   \texttt{nodeptr} has been processed).
-  \texttt{info} is a pointer to some information passed to the function
-  \texttt{depthfirststree}.
 */
 
-static Sint processbranch2(/*@unused@*/ Bref nodeptr,void *info)
+static inline Sint processbranch2(Maxmatchinfo *maxmatchinfo)
 {
-  Maxmatchinfo *maxmatchinfo = (Maxmatchinfo *) info;
-
   maxmatchinfo->commondepthstack.nextfreeNodeinfo--;
   return 0;
 }
 
+/*
+  The previous three functions are passed to \texttt{depthfirsttraversal}
+  via the following classes, so that they are inlined into the traversal.
+*/
+
+struct Maxmatchleaf
+{
+  Maxmatchinfo *maxmatchinfo;
+  Sint operator()(Uint leafindex,/*@unused@*/ Bref lcpnode) const
+  {
+    return processleaf(maxmatchinfo,leafindex);
+  }
+};
+
+struct Maxmatchbranch1
+{
+  Maxmatchinfo *maxmatchinfo;
+  bool operator()(Bref nodeptr) const
+  {
+    return processbranch1(maxmatchinfo,nodeptr);
+  }
+};
+
+struct Maxmatchbranch2
+{
+  Maxmatchinfo *maxmatchinfo;
+  Sint operator()(/*@unused@*/ Bref nodeptr) const
+  {
+    return processbranch2(maxmatchinfo);
+  }
+};
+
+/*
+  If only the matches unique in the subject-sequence are to be reported,
+  then only \texttt{pmax} can be such a match, since each shorter prefix
+  of the query suffix occurs wherever \texttt{pmax} occurs. The number of
+  occurrences of \texttt{pmax} is the number of leaves below the node
+  \texttt{maxloc} leads to, which is looked up in the table 
+  \texttt{leafcounts}. So the subtree need not be traversed. If 
+  \texttt{pmax} is unique, then the leaf is processed as usual.
+*/
+
+static Sint processuniquematch(Maxmatchinfo *maxmatchinfo)
+{
+  Suffixtree *stree = maxmatchinfo->stree;
+  Location *maxloc = &maxmatchinfo->maxloc;
+  Uint occurrences, headposition, distance, *largeptr;
+
+  if(maxloc->nextnode.toleaf)
+  {
+    occurrences = UintConst(1);
+  } else
+  {
+    GETONLYHEADPOS(headposition,maxloc->nextnode.address);
+    occurrences = stree->leafcounts[headposition];
+  }
+  if(occurrences > UintConst(1))
+  {
+    return 0;
+  }
+  return processleaf(maxmatchinfo,
+                     LEAFADDR2NUM(stree,maxloc->nextnode.address));
+}
+
 /*
   The following function computes the maximal matches below location
   \(ploc\). All global information is passed via the 
@@ -341,16 +375,24 @@ static Sint enumeratemaxmatches (Maxmatchinfo *maxmatchinfo,
           maxmatchinfo->query+maxmatchinfo->querylen-1, rescanprefixlength);
   maxmatchinfo->depthofpreviousmaxloc = maxmatchinfo->maxloc.locstring.length;
   maxmatchinfo->commondepthstack.nextfreeNodeinfo = 0;
+  if(maxmatchinfo->uniqueonly)
+  {
+    return processuniquematch(maxmatchinfo);
+  }
   if(ploc->nextnode.toleaf)
   { 
-    if(processleaf(LEAFADDR2NUM(maxmatchinfo->stree,ploc->nextnode.address), NULL,(void *) maxmatchinfo) != 0)
+    if(processleaf(maxmatchinfo,LEAFADDR2NUM(maxmatchinfo->stree,ploc->nextnode.address)) != 0)
     {
       return -1;
     }
   } else
   {
-    (void) processbranch1(ploc->nextnode.address,(void *) maxmatchinfo);
-    if(depthfirststree(maxmatchinfo->stree, &ploc->nextnode, processleaf, processbranch1, processbranch2, NULL, NULL, (void *) maxmatchinfo) != 0)
+    Maxmatchleaf leaf = {maxmatchinfo};
+    Maxmatchbranch1 branch1 = {maxmatchinfo};
+    Maxmatchbranch2 branch2 = {maxmatchinfo};
+
+    (void) processbranch1(maxmatchinfo,ploc->nextnode.address);
+    if(depthfirsttraversal(maxmatchinfo->stree, &ploc->nextnode, &maxmatchinfo->dfsstack, leaf, branch1, branch2) != 0)
     { 
       return -2;
     }
@@ -358,6 +400,440 @@ static Sint enumeratemaxmatches (Maxmatchinfo *maxmatchinfo,
   return 0;
 } 
 
+ 
+
+/*
+  The query is split into chunks which are processed in parallel. A
+  chunk consists of a range of start positions of query suffixes. Since
+  a match starting in a chunk may extend beyond its end, the scan of
+  a chunk reads up to \texttt{minmatchlength} characters into the next
+  chunk (and \texttt{maxloc} may be extended to the end of the query).
+  But each match is reported by exactly one chunk, namely the chunk
+  containing the start of the match in the query. Each chunk has its
+  own \texttt{Maxmatchinfo}-record, so that the stacks are not shared
+  between the threads. The matches of a chunk are collected in the
+  following array and are finally passed to \texttt{processmatch} in
+  the order of the chunks. So the matches are reported in the same
+  order as by a sequential scan of the query.
+*/
+
+struct Foundmatch
+{
+  Uint matchlength,   // length of match
+       subjectstart,  // start of match in subject-sequence
+       querystart;    // start of match in query
+};
+
+DECLAREARRAYSTRUCT(Foundmatch);
+
+static Sint storefoundmatch(void *info,Uint matchlength,Uint subjectstart,
+                            /*@unused@*/ Uint seqnum,Uint querystart)
+{
+  ArrayFoundmatch *foundmatches = (ArrayFoundmatch *) info;
+  Foundmatch *foundmatchptr;
+
+  GETNEXTFREEINARRAY(foundmatchptr,foundmatches,Foundmatch,1024);
+  foundmatchptr->matchlength = matchlength;
+  foundmatchptr->subjectstart = subjectstart;
+  foundmatchptr->querystart = querystart;
+  return 0;
+}
+
+/*
+  In the hybrid mode, the direct access table is used for those query
+  suffixes, for which the bucket of their first \texttt{prefix} characters
+  contains at most \texttt{hybridthreshold} suffixes of the subject-sequence.
+  The suffixes of such a bucket are directly compared to the query suffix.
+  The bucket is sorted in the order of the leaves in a depth first
+  traversal, and all suffixes sharing the first \texttt{minmatchlength}
+  characters of the query suffix are in the same bucket. So the matches
+  are reported in the same order as by \texttt{enumeratemaxmatches}.
+  For query suffixes with a larger bucket, the suffix tree is scanned
+  using suffix links. Since the scan must then be restarted from the root,
+  which costs up to \texttt{minmatchlength} character comparisons, the scan
+  is continued until the buckets of \texttt{minmatchlength} consecutive
+  query suffixes are small.
+*/
+
+struct Hybridinfo
+{
+  Table *table;           // the direct access table, or NULL
+  Uint hybridthreshold;   // maximal size of a bucket to be verified
+  bool uniqueonly;        // only report matches unique in subject
+};
+
+static Uint lcp(Uchar *start1,Uchar *end1,Uchar *start2,Uchar *end2)
+{
+  register Uchar *ptr1 = start1, 
+                 *ptr2 = start2;
+
+  while(ptr1 <= end1 && ptr2 <= end2 && *ptr1 == *ptr2)
+  {
+    ptr1++;
+    ptr2++;
+  }
+  return (Uint) (ptr1-start1);
+}
+
+/*
+  The following function reports the matches of length at least 
+  \texttt{minmatchlength} between the current query suffix and
+  the \texttt{bucketsize} suffixes in \texttt{bucket}, provided they 
+  are left maximal.
+*/
+
+static Sint verifybucket(Maxmatchinfo *maxmatchinfo,suffix *bucket,
+                         Uint bucketsize)
+{
+  Uchar *text = maxmatchinfo->stree->text,
+        *querysuffix = maxmatchinfo->querysuffix,
+        *rightq = maxmatchinfo->query + maxmatchinfo->querylen - 1,
+        *rightr = text + maxmatchinfo->stree->textlen - 1;
+  suffix *suf;
+  Uint lcplength;
+
+  for(suf = bucket; suf < bucket + bucketsize; suf++)
+  {
+    if(suf->position == 0 ||
+       querysuffix == maxmatchinfo->query ||
+       text[suf->position - 1] != *(querysuffix-1))
+    {
+      lcplength = lcp(querysuffix,rightq,text + suf->position,rightr);
+      if(lcplength >= maxmatchinfo->minmatchlength &&
+         maxmatchinfo->processmatch(maxmatchinfo->processinfo,
+                                    lcplength,
+                                    suf->position,
+                                    maxmatchinfo->queryseqnum,
+                                    (Uint) (querysuffix - 
+                                            maxmatchinfo->query)) != 0)
+      {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*
+  The following function computes the maximal matches starting at
+  the positions \texttt{chunkstart} to \texttt{chunkend}\(-1\) of the query.
+  Initially, the function appropriately intializes the
+  \texttt{maxmatchinfo}-record. In the \texttt{for}-loop each instance 
+  of \texttt{ploc} is determined and processed further by 
+  \texttt{enumeratemaxmatches} whenever its depth is at least the minimum
+  match length. \texttt{plocsuffix} is the query suffix for which 
+  \texttt{ploc} was determined before. If this is the previous
+  query suffix, then \texttt{ploc} is obtained by following the suffix 
+  link. Otherwise the query suffix is scanned from the root, and the
+  depth of \texttt{ploc} is stored in \texttt{depthofpreviousmaxloc}.
+  In the hybrid mode, \texttt{ploc} is only determined for the query
+  suffixes processed by the suffix link scan.
+*/
+
+static Sint findmaxmatchesinchunk(Suffixtree *stree,
+                                  Hybridinfo *hybridinfo,
+                                  Uint minmatchlength,
+                                  ArrayFoundmatch *foundmatches,
+                                  Uchar *query,
+                                  Uint querylen,
+                                  Uint queryseqnum,
+                                  Uint chunkstart,
+                                  Uint chunkend)
+{
+  Uchar *querysubstringend,  // ref to end of querysubs. of len. minmatchl.
+        *plocsuffix = NULL;
+  Location ploc;
+  Maxmatchinfo maxmatchinfo;
+  Uint code, bucketsize = 0, smallbuckets = 0;
+  bool suffixlinkscan = (hybridinfo->table == NULL);
+  Sint retcode = 0;
+
+  maxmatchinfo.stree = stree;
+  maxmatchinfo.uniqueonly = hybridinfo->uniqueonly;
+  INITARRAY(&maxmatchinfo.commondepthstack,Nodeinfo);
+  INITARRAY(&maxmatchinfo.matchpath,Pathinfo);
+  INITARRAY(&maxmatchinfo.dfsstack,Bref);
+  maxmatchinfo.query = query;
+  maxmatchinfo.querylen = querylen;
+  maxmatchinfo.minmatchlength = minmatchlength;
+  maxmatchinfo.queryseqnum = queryseqnum;
+  maxmatchinfo.processmatch = storefoundmatch;
+  maxmatchinfo.processinfo = (void *) foundmatches;
+  for (maxmatchinfo.querysuffix = query + chunkstart; 
+       maxmatchinfo.querysuffix < query + chunkend; 
+       maxmatchinfo.querysuffix++)
+  {
+    if(hybridinfo->table != NULL)
+    {
+      code = encoding(maxmatchinfo.querysuffix,(int) hybridinfo->table->prefix);
+      bucketsize = BUCKETSIZE(hybridinfo->table,code);
+      if(bucketsize > hybridinfo->hybridthreshold)
+      {
+        suffixlinkscan = true;
+        smallbuckets = 0;
+      } else
+      {
+        if(suffixlinkscan && ++smallbuckets >= minmatchlength)
+        {
+          suffixlinkscan = false;
+        }
+      }
+    }
+    if(!suffixlinkscan)
+    {
+      if(bucketsize > 0 &&
+         verifybucket(&maxmatchinfo,BUCKETSTART(hybridinfo->table,code),
+                      bucketsize) != 0)
+      {
+        retcode = -1;
+        break;
+      }
+      continue;
+    }
+    querysubstringend = maxmatchinfo.querysuffix + minmatchlength - 1;
+    if(plocsuffix != NULL && plocsuffix + 1 == maxmatchinfo.querysuffix)
+    {
+      if (ROOTLOCATION (&ploc))
+      {
+        (void) scanprefixfromnodestree (stree, &ploc, ROOT (stree), 
+                                        maxmatchinfo.querysuffix, 
+                                        querysubstringend,0);
+      } else
+      {
+        linklocstree (stree, &ploc, &ploc);
+        (void) scanprefixstree (stree, &ploc, &ploc,
+                                maxmatchinfo.querysuffix+
+                                ploc.locstring.length,
+                                querysubstringend,0);
+      }
+    } else
+    {
+      (void) scanprefixfromnodestree (stree, &ploc, ROOT (stree), 
+                                      maxmatchinfo.querysuffix, 
+                                      querysubstringend,0);
+      maxmatchinfo.depthofpreviousmaxloc = ploc.locstring.length;
+    }
+    plocsuffix = maxmatchinfo.querysuffix;
+    if(ploc.locstring.length >= minmatchlength &&
+       enumeratemaxmatches(&maxmatchinfo,&ploc) != 0)
+    {
+      retcode = -2;
+      break;
+    }
+  }
+  FREEARRAY(&maxmatchinfo.commondepthstack,Nodeinfo);
+  FREEARRAY(&maxmatchinfo.matchpath,Pathinfo);
+  FREEARRAY(&maxmatchinfo.dfsstack,Bref);
+  return retcode;
+}
+
+/*
+  In the minimizer mode, the table only contains the suffixes of the 
+  subject-sequence starting at the minimizers of the windows of
+  \texttt{minimizerwindow} consecutive prefixes of length \texttt{prefix}.
+  A maximal match of length at least \(\texttt{minimizerwindow}+
+  \texttt{prefix}-1\) contains the first window of its instance in the
+  query, and the minimizer of this window occurs at the same offset in
+  the instance in the subject-sequence. So each such match is found by
+  extending the hits of the minimizers of the query to the left and to
+  the right. A match is only reported for the minimizer of its first 
+  window, and is thus reported exactly once. Since this minimizer is at 
+  most \(\texttt{minimizerwindow}-1\) positions right of the start of 
+  the match, the left extension can stop there.
+
+  In the sparse mode, the table only contains the suffixes of the
+  subject-sequence starting at the multiples of \texttt{sparsestep}. 
+  A maximal match of length at least \(\texttt{sparsestep}+
+  \texttt{prefix}-1\) contains such a suffix at an offset smaller than
+  \texttt{sparsestep}, followed by at least \texttt{prefix} characters.
+  So each such match is found by extending the hits of all query 
+  suffixes, and it is only reported for the first sampled suffix, i.e.\
+  if the left extension is shorter than \texttt{sparsestep}.
+
+  The matches of a chunk are sorted by their start in the query, and the
+  matches with the same start are sorted in lexicographic order of their
+  suffixes of the subject-sequence, where the end of the subject-sequence
+  is larger than all characters. So the matches are reported in the same 
+  order as by \texttt{enumeratemaxmatches}.
+
+  If \texttt{packedtext} of \texttt{probeoptions} is not \texttt{NULL}, 
+  then the subject-sequence is only available in packed form, and the
+  extensions and comparisons decode it.
+*/
+
+struct Byqueryandsubject
+{
+  Uchar *text, *textend;
+  Packedseq *packedtext;
+  bool operator()(const Foundmatch &a,const Foundmatch &b) const
+  {
+    Uchar *ptr1, *ptr2;
+
+    if(a.querystart != b.querystart)
+    {
+      return a.querystart < b.querystart;
+    }
+    if(packedtext != NULL)
+    {
+      return packedseqcompare(packedtext,
+                              a.subjectstart + MIN(a.matchlength,
+                                                   b.matchlength),
+                              b.subjectstart + MIN(a.matchlength,
+                                                   b.matchlength)) < 0;
+    }
+    ptr1 = text + a.subjectstart + MIN(a.matchlength,b.matchlength);
+    ptr2 = text + b.subjectstart + MIN(a.matchlength,b.matchlength);
+    while(ptr1 < textend && ptr2 < textend && *ptr1 == *ptr2)
+    {
+      ptr1++;
+      ptr2++;
+    }
+    if(ptr1 == textend)
+    {
+      return false;
+    }
+    if(ptr2 == textend)
+    {
+      return true;
+    }
+    return *ptr1 < *ptr2;
+  }
+};
+
+/*
+  The following function stores the maximal matches of length at least
+  \texttt{minmatchlength} containing the query suffix at \texttt{querypos}
+  and a suffix of its bucket at the same offset, provided the match is 
+  reported for this pair of suffixes and starts at one of the positions 
+  \texttt{chunkstart} to \texttt{chunkend}\(-1\) of the query.
+*/
+
+static void extendsampledhits(Suffixtree *stree,
+                              Table *table,
+                              Probeoptions *probeoptions,
+                              Uint minmatchlength,
+                              ArrayFoundmatch *foundmatches,
+                              Uchar *query,
+                              Uint querylen,
+                              Uint querypos,
+                              Uint chunkstart,
+                              Uint chunkend)
+{
+  Uchar *text = stree->text,
+        *rightq = query + querylen - 1,
+        *rightr = text + stree->textlen - 1;
+  Uint code, subjectpos, leftlength, rightlength, maxleftlength,
+       queryword = 0, querywordlen = 0;
+  suffix *suf, *bucketend;
+  Foundmatch *foundmatchptr;
+  Packedseq *packedtext = probeoptions->packedtext;
+
+  maxleftlength = (probeoptions->minimizerwindow > 0)
+                    ? probeoptions->minimizerwindow
+                    : probeoptions->sparsestep;
+  code = encoding(query + querypos,(int) table->prefix);
+  bucketend = BUCKETSTART(table,code) + BUCKETSIZE(table,code);
+  if(packedtext != NULL && BUCKETSIZE(table,code) > 0)
+  {
+    querywordlen = packquerybases(query + querypos,
+                                  MIN(querylen - querypos,
+                                      PACKEDBASESPERWORD),&queryword);
+  }
+  for(suf = BUCKETSTART(table,code); suf < bucketend; suf++)
+  {
+    subjectpos = suf->position;
+    if(packedtext != NULL)
+    {
+      rightlength = packedseqlcp(packedtext,subjectpos,query + querypos,
+                                 querylen - querypos,queryword,
+                                 querywordlen);
+    } else
+    {
+      rightlength = lcp(query + querypos,rightq,text + subjectpos,rightr);
+    }
+    if(rightlength < table->prefix)
+    {
+      continue;
+    }
+    for(leftlength = 0; leftlength < maxleftlength &&
+                        leftlength < querypos && 
+                        leftlength < subjectpos &&
+                        query[querypos-leftlength-1] == 
+                        ((packedtext != NULL) 
+                          ? packedseqchar(packedtext,subjectpos-leftlength-1)
+                          : text[subjectpos-leftlength-1]); leftlength++)
+      /* Nothing */ ;
+    if(leftlength >= maxleftlength ||
+       leftlength + rightlength < minmatchlength ||
+       querypos - leftlength < chunkstart ||
+       querypos - leftlength >= chunkend)
+    {
+      continue;
+    }
+    if(probeoptions->minimizerwindow > 0 &&
+       windowminimizer(query + querypos - leftlength,table->prefix,
+                       probeoptions->minimizerwindow) != leftlength)
+    {
+      continue;
+    }
+    GETNEXTFREEINARRAY(foundmatchptr,foundmatches,Foundmatch,1024);
+    foundmatchptr->matchlength = leftlength + rightlength;
+    foundmatchptr->subjectstart = subjectpos - leftlength;
+    foundmatchptr->querystart = querypos - leftlength;
+  }
+}
+
+/*
+  The following function computes the maximal matches starting at
+  the positions \texttt{chunkstart} to \texttt{chunkend}\(-1\) of the 
+  query in the minimizer mode or in the sparse mode. 
+  \texttt{queryminimizers} are the positions of the minimizers of the 
+  query in increasing order.
+*/
+
+static void findsampledmatchesinchunk(Suffixtree *stree,
+                                      Table *table,
+                                      Probeoptions *probeoptions,
+                                      Uint minmatchlength,
+                                      ArrayFoundmatch *foundmatches,
+                                      Uchar *query,
+                                      Uint querylen,
+                                      vector<Uint> &queryminimizers,
+                                      Uint chunkstart,
+                                      Uint chunkend)
+{
+  Byqueryandsubject byqueryandsubject = {stree->text,
+                                         stree->text + stree->textlen,
+                                         probeoptions->packedtext};
+  vector<Uint>::iterator minimizer;
+  Uint querypos;
+
+  if(probeoptions->minimizerwindow > 0)
+  {
+    for(minimizer = lower_bound(queryminimizers.begin(),
+                                queryminimizers.end(),chunkstart);
+        minimizer != queryminimizers.end() && 
+        *minimizer < chunkend + probeoptions->minimizerwindow - 1;
+        minimizer++)
+    {
+      extendsampledhits(stree,table,probeoptions,minmatchlength,foundmatches,
+                        query,querylen,*minimizer,chunkstart,chunkend);
+    }
+  } else
+  {
+    for(querypos = chunkstart; 
+        querypos < chunkend + probeoptions->sparsestep - 1 &&
+        querypos + table->prefix <= querylen; querypos++)
+    {
+      extendsampledhits(stree,table,probeoptions,minmatchlength,foundmatches,
+                        query,querylen,querypos,chunkstart,chunkend);
+    }
+  }
+  sort(foundmatches->spaceFoundmatch,
+       foundmatches->spaceFoundmatch + foundmatches->nextfreeFoundmatch,
+       byqueryandsubject);
+}
+
 /*EE
   The following function finds all maximal matches between the 
   subject sequence and the query sequence of length at least
@@ -365,73 +841,109 @@ static Sint enumeratemaxmatches (Maxmatchinfo *maxmatchinfo,
   is applied, with \texttt{processinfo} as its first argument.
   \texttt{query} is the reference to the query, \texttt{querylen} is the
   length of the query and \texttt{queryseqnum} is the number of the
-  query sequence. Initially, the function appropriately intializes the
-  \texttt{maxmatchinfo}-record. It then scans \texttt{query} to find
-  \texttt{ploc} for the longest suffix of \texttt{query}.
-  The depth of \texttt{ploc} is stored in \texttt{depthofpreviousmaxloc}.
-  In the \texttt{for}-loop each instance of \texttt{ploc} is determined
-  and processed further by \texttt{enumeratemaxmatches} whenever its 
-  depth is longer than the minimum match length.
+  query sequence. The \(\texttt{querylen}-\texttt{minmatchlength}+1\)
+  start positions of the matches are split into \texttt{chunks} chunks,
+  but into at least one chunk per thread. If the \texttt{hybridthreshold}
+  of \texttt{probeoptions} is not 0, then the buckets of \texttt{table}
+  with at most \texttt{hybridthreshold} suffixes are verified directly. This requires 
+  that \texttt{prefix} is not larger than \texttt{minmatchlength}.
+  If the \texttt{minimizerwindow} or the \texttt{sparsestep} of 
+  \texttt{probeoptions} is not 0, then \texttt{table} only contains the
+  minimizers or every \texttt{sparsestep}-th suffix of the 
+  subject-sequence, and the suffix tree is not used.
+  If \texttt{leafcounts} of \texttt{probeoptions} is \texttt{true}, then
+  only the matches unique in the subject-sequence, i.e.\ the 
+  MUM-candidates, are reported. This requires that the table
+  \texttt{leafcounts} of the suffix tree is computed. If 
+  \texttt{processmatch} is \texttt{NULL}, then the matches are only 
+  computed.
 */
 
-Sint findmaxmatches(Uchar *reference,
-                    Uint referencelen,
+Sint findmaxmatches(Suffixtree *stree,
                     Table &table,
                     Uint minmatchlength,
                     Uint chunks,
                     Uint prefix,
+                    Probeoptions *probeoptions,
                     Processmatchfunction processmatch,
                     void *processinfo,
                     Uchar *query,
                     Uint querylen,
                     Uint queryseqnum)
 { 
-  /*Uchar *querysubstringend;  // ref to end of querysubs. of len. minmatchl.
-  Location ploc;
-  Maxmatchinfo maxmatchinfo;
-  if(querylen < minmatchlength)
+  Uint numofstarts, numofchunks;
+  Hybridinfo hybridinfo;
+  vector<Uint> queryminimizers;
+  Sint retcode = 0;
+
+  if(querylen < minmatchlength || minmatchlength == 0)
+  {
     return 0;
-  DECLAREEXTRA;
-  maxmatchinfo.stree = stree;
-  INITARRAY(&maxmatchinfo.commondepthstack,Nodeinfo);
-  INITARRAY(&maxmatchinfo.matchpath,Pathinfo);
-  maxmatchinfo.querysuffix = maxmatchinfo.query = query;
-  maxmatchinfo.querylen = querylen;
-  maxmatchinfo.minmatchlength = minmatchlength;
-  maxmatchinfo.queryseqnum = queryseqnum;
-  maxmatchinfo.processmatch = processmatch;
-  maxmatchinfo.processinfo = processinfo;
-  querysubstringend = query + minmatchlength - 1;
-  (void) scanprefixfromnodestree (stree, &ploc, ROOT (stree), query, querysubstringend,0);
-  maxmatchinfo.depthofpreviousmaxloc = ploc.locstring.length;
-  for (;querysubstringend<query+querylen-1;++querysubstringend,++maxmatchinfo.querysuffix)
+  }
+  if(probeoptions->hybridthreshold > 0 && prefix > 0 && 
+     prefix <= minmatchlength)
   {
-        //(void) scanprefixfromnodestree (stree, &ploc, ROOT (stree), maxmatchinfo.querysuffix, querysubstringend,0);
-        CHECKSTEP;
-        if(ploc.locstring.length >= minmatchlength &&  enumeratemaxmatches(&maxmatchinfo,&ploc) != 0)
-            return -1;
-        if (ROOTLOCATION (&ploc)) 
-            (void) scanprefixfromnodestree (stree, &ploc, ROOT (stree), maxmatchinfo.querysuffix+1, querysubstringend+1,0);
-        else 
-        {
-            //fprintf(stderr,"# ");
-            //SHOWINDEX((Uint) BRADDR2NUM(stree,ploc.previousnode));
-            //fprintf(stderr,"| -->");
-            linklocstree (stree, &ploc, &ploc);
-            (void) scanprefixstree (stree, &ploc, &ploc, maxmatchinfo.querysuffix+ploc.locstring.length+1, querysubstringend+1,0);
-        }
+    hybridinfo.table = &table;
+  } else
+  {
+    hybridinfo.table = NULL;
+  }
+  hybridinfo.hybridthreshold = probeoptions->hybridthreshold;
+  hybridinfo.uniqueonly = probeoptions->leafcounts;
+  if(probeoptions->minimizerwindow > 0)
+  {
+    minimizerpositions(query,prefix,probeoptions->minimizerwindow,0,
+                       querylen + 2 - prefix - probeoptions->minimizerwindow,
+                       queryminimizers);
   }
- while (!ROOTLOCATION (&ploc) && ploc.locstring.length >= minmatchlength)
+  numofstarts = querylen - minmatchlength + 1;
+  numofchunks = MIN(MAX(chunks,(Uint) omp_get_max_threads()),numofstarts);
+#pragma omp parallel for schedule(dynamic,1) ordered
+  for(Uint chunk = 0; chunk < numofchunks; chunk++)
   {
-    if(enumeratemaxmatches (&maxmatchinfo,&ploc) != 0)
+    ArrayFoundmatch foundmatches;
+    Foundmatch *foundmatchptr;
+    Uint chunkstart = (Uint) ((double) numofstarts * chunk / numofchunks),
+         chunkend = (Uint) ((double) numofstarts * (chunk+1) / numofchunks);
+    Sint chunkretcode = 0;
+
+    INITARRAY(&foundmatches,Foundmatch);
+    if(probeoptions->minimizerwindow > 0 || probeoptions->sparsestep > 0)
     {
-      return -2;
+      findsampledmatchesinchunk(stree,&table,probeoptions,minmatchlength,
+                                &foundmatches,query,querylen,queryminimizers,
+                                chunkstart,chunkend);
+    } else
+    {
+      if(chunkstart < chunkend)
+      {
+        chunkretcode = findmaxmatchesinchunk(stree,&hybridinfo,minmatchlength,
+                                             &foundmatches,query,querylen,
+                                             queryseqnum,chunkstart,chunkend);
+      }
     }
-    linklocstree (stree, &ploc, &ploc);
-    maxmatchinfo.querysuffix++;
+#pragma omp ordered
+    {
+      if(chunkretcode != 0 && retcode == 0)
+      {
+        retcode = -1;
+      }
+      for(foundmatchptr = foundmatches.spaceFoundmatch;
+          retcode == 0 && processmatch != NULL && foundmatchptr < foundmatches.spaceFoundmatch +
+                                          foundmatches.nextfreeFoundmatch;
+          foundmatchptr++)
+      {
+        if(processmatch(processinfo,
+                        foundmatchptr->matchlength,
+                        foundmatchptr->subjectstart,
+                        queryseqnum,
+                        foundmatchptr->querystart) != 0)
+        {
+          retcode = -2;
+        }
+      }
+    }
+    FREEARRAY(&foundmatches,Foundmatch);
   }
-  FREEARRAY(&maxmatchinfo.commondepthstack,Nodeinfo);
-  FREEARRAY(&maxmatchinfo.matchpath,Pathinfo);
-  cerr << endl;*/
-  return 0;
+  return retcode;
 }
@@ -17,12 +17,14 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <papi.h>
 #include <assert.h>
 #include "streedef.h"
 #include "spacedef.h"
 #include "maxmatdef.h"
 #include "distribute.h"
+#include "minmax.h"
 
 //}
 
@@ -289,6 +291,415 @@ static void  Process_Matches (Match_t * A, int N) //  Process matches  A [1 .. N
    return;
   }
 
+/*
+  Ranges of at least \texttt{PARALLELBUCKETSIZE} suffixes are verified
+  in parallel, in blocks of \texttt{BUCKETBLOCKSIZE} suffixes. Such a
+  range consists of the leaves below the locus of the first 
+  \texttt{minmatchlength} characters of the query, and could thus be
+  enumerated by \texttt{parallelsubtreeenumeration}. But the bucket
+  already stores these leaves in the same order together with the depth
+  of their fathers, so that splitting the range into blocks avoids the
+  traversal of the subtree, which takes much longer than verifying a 
+  leaf.
+*/
+
+#define PARALLELBUCKETSIZE 4096
+#define BUCKETBLOCKSIZE    1024
+
+/*
+  The following function checks if the match of the query at \texttt{leftq}
+  and the reference suffix \texttt{suf} is left maximal and continues
+  after the depth of the father of \texttt{suf}, i.e.\ it is unique in the
+  reference. In this case the length of the match is returned, and 0 
+  otherwise. The characters at the depth are compared first, since they
+  are equal for all such matches. The query must not end
+  before this depth, since the character after its end is undefined.
+*/
+
+static inline Uint verifysuffix(suffix &suf, Uchar *query, Uchar *leftq, Uchar *rightq, Uchar *reference, Uchar *rightr, Uint prefix)
+{
+  Uchar *leftr = reference+suf.position;
+
+  if ((leftq == query || leftr == reference || *(leftq-1) != *(leftr-1)) && leftq+suf.depth <= rightq && *(leftq+suf.depth) == *(leftr+suf.depth)) //Check left and right maximal
+  {
+      Uint length = lcp(leftq+prefix,rightq,leftr+prefix,rightr)+prefix;
+
+      if (length > suf.depth) //Equal characters at the depth may be a mismatch before
+          return length;
+  }
+  return 0;
+}
+
+/*
+  The following function compares the first \texttt{length} characters of
+  the query at \texttt{leftq} and of the reference at \texttt{leftr}.
+  \texttt{endr} points to the end of the reference, which is larger than
+  any character, as in the suffix tree. The result is negative, zero or
+  positive, if the query is smaller, equal or larger, respectively.
+*/
+
+static inline Sint comparewindow(Uchar *leftq, Uint length, Uchar *leftr, Uchar *endr)
+{
+  for (Uint i = 0; i < length; i++)
+  {
+      if (leftr + i == endr)
+          return -1;
+      if (leftq[i] != leftr[i])
+          return (leftq[i] < leftr[i]) ? -1 : 1;
+  }
+  return 0;
+}
+
+/*
+  The suffixes of a bucket sharing the first \texttt{minmatchlength}
+  characters with the query at \texttt{leftq} form a range of the bucket,
+  since it is sorted lexicographically. The following function finds the
+  first suffix of the range by binary search. The range ends at the first
+  following suffix whose longest common prefix with its predecessor is
+  shorter than \texttt{minmatchlength}. All suffixes outside of the range
+  match the query for less than \texttt{minmatchlength} characters, and
+  so they need not be verified.
+*/
+
+static void findmatchrange(suffix *suffixes, Uint numofsuffixes, Uchar *leftq, Uint minmatchlength, Uchar *reference, Uchar *endr, Uint *first, Uint *last)
+{
+  Uint lo = 0, hi = numofsuffixes, mid;
+
+  while (lo < hi)
+  {
+      mid = lo + (hi-lo)/2;
+      if (comparewindow(leftq,minmatchlength,reference+suffixes[mid].position,endr) > 0)
+          lo = mid+1;
+      else
+          hi = mid;
+  }
+  *first = *last = lo;
+  if (lo < numofsuffixes && 
+      comparewindow(leftq,minmatchlength,reference+suffixes[lo].position,endr) == 0)
+  {
+      for ((*last)++; *last < numofsuffixes && 
+                      suffixes[*last].lcp >= minmatchlength; (*last)++)
+          /* Nothing */ ;
+  }
+}
+
+/*
+  The following function verifies the suffixes \texttt{first} to
+  \texttt{last}\(-1\) of a bucket against the query at \texttt{leftq}
+  and appends the matches of length at least \texttt{minmatchlength}
+  to \texttt{matches}. The positions of the matches are 1-based.
+*/
+
+static void verifyrange(suffix *suffixes, Uint first, Uint last, Uchar *query, Uchar *leftq, Uchar *rightq, Uchar *reference, Uchar *rightr, Uint prefix, Uint minmatchlength, vector<Match_t> &matches)
+{
+  Match_t match;
+
+  for (Uint k=first; k < last; k++)
+  {
+      Uint length = verifysuffix(suffixes[k],query,leftq,rightq,reference,rightr,prefix);
+      if (length >= minmatchlength)
+      {
+          match.R = suffixes[k].position+1;
+          match.Q = (Uint) (leftq-query)+1;
+          match.Len = length;
+          match.Good = true;
+          matches.push_back(match);
+      }
+  }
+}
+
+/*
+  The following function appends a match with the given 0-based positions
+  to the array \texttt{A} of \texttt{N} matches, for which \texttt{Size}
+  entries are allocated.
+*/
+
+static void appendmatch(Match_t **A, Uint *N, Uint *Size, Uint subjectstart, Uint querystart, Uint length)
+{
+  if (*N >= *Size)
+  {
+      *Size *= 2;
+      *A = (Match_t *) Safe_realloc (*A, *Size * sizeof (Match_t));
+  }
+  (*A)[*N].R = subjectstart+1;
+  (*A)[*N].Q = querystart+1;
+  (*A)[*N].Len = length;
+  (*A)[*N].Good = true;
+  (*N)++;
+}
+
+/*
+  Probes hitting a bucket with more than \texttt{bucketcap} suffixes are
+  not verified during the scan of the query. They are stored in a queue
+  of elements of the following type. \texttt{matchnum} is the number of
+  matches found before the probe, so that the matches of the probe can
+  later be inserted at the same place in the array of matches.
+*/
+
+struct Deferredprobe
+{
+  Uint code,                 // the code of the bucket hit by the probe
+       querystart,           // start of the probe in the query
+       matchnum;             // number of matches found before the probe
+  vector<Match_t> matches;   // the matches found for the probe
+};
+
+/*
+  The deferred probes are processed bucket by bucket, so that the
+  suffixes of a bucket are read while they are in the cache. Probes
+  of the same bucket are processed in the order of the query.
+*/
+
+struct Bybucket
+{
+  vector<Deferredprobe> *deferred;
+  bool operator()(Uint a, Uint b) const
+  {
+    Deferredprobe &pa = (*deferred)[a], &pb = (*deferred)[b];
+
+    if (pa.code != pb.code)
+        return pa.code < pb.code;
+    return pa.querystart < pb.querystart;
+  }
+};
+
+/*
+  The following function verifies the deferred probes in parallel and
+  inserts their matches into the array \texttt{A} of \texttt{N} matches.
+  The resulting array is the same as if the probes had been verified
+  during the scan. The number of suffixes verified and pruned is added
+  to \texttt{verified} and \texttt{pruned}.
+*/
+
+static void processdeferredprobes(Table &table, vector<Deferredprobe> &deferred, Match_t **A, Uint *N, Uint *Size, Uchar *query, Uchar *rightq, void **threadreference, Uint referencelen, Uint prefix, Uint minmatchlength, Uint *verified, Uint *pruned)
+{
+  vector<Uint> order(deferred.size());
+  Bybucket bybucket = {&deferred};
+  Uint i, j, next, nummatches = *N, sumverified = 0, sumpruned = 0;
+  Match_t *B;
+
+  for (i = 0; i < (Uint) deferred.size(); i++)
+      order[i] = i;
+  sort(order.begin(),order.end(),bybucket);
+#pragma omp parallel for schedule(dynamic,16) reduction(+:sumverified,sumpruned)
+  for (i = 0; i < (Uint) order.size(); i++)
+  {
+      Deferredprobe &probe = deferred[order[i]];
+      Uint first, last;
+      Uchar *reference = (Uchar *) threadreference[omp_get_thread_num()],
+            *rightr = reference + referencelen - 1;
+
+      suffix *bucket = BUCKETSTART(&table,probe.code);
+      Uint bucketsize = BUCKETSIZE(&table,probe.code);
+
+      findmatchrange(bucket,bucketsize,query+probe.querystart,minmatchlength,reference,rightr+1,&first,&last);
+      verifyrange(bucket,first,last,query,query+probe.querystart,rightq,reference,rightr,prefix,minmatchlength,probe.matches);
+      sumverified += last - first;
+      sumpruned += bucketsize - (last - first);
+  }
+  *verified += sumverified;
+  *pruned += sumpruned;
+  for (i = 0; i < (Uint) deferred.size(); i++)
+      nummatches += (Uint) deferred[i].matches.size();
+  if (nummatches == *N)
+      return;
+  B = (Match_t *) Safe_malloc (MAX(nummatches,*Size) * sizeof (Match_t));
+  for (i = 0, j = 0, next = 0; i < (Uint) deferred.size(); i++)
+  {
+      for (; next < deferred[i].matchnum; next++)
+          B[j++] = (*A)[next];
+      for (vector<Match_t>::iterator m=deferred[i].matches.begin(); m!=deferred[i].matches.end(); ++m)
+          B[j++] = *m;
+  }
+  for (; next < *N; next++)
+      B[j++] = (*A)[next];
+  free(*A);
+  *A = B;
+  *N = nummatches;
+  *Size = MAX(nummatches,*Size);
+}
+
+/*
+  In the batch mode, the query positions are not probed in the order of
+  the query. Instead, for each block of \texttt{BATCHBLOCKSIZE} positions
+  the pairs of the code and the query position are sorted by the code, 
+  using a radix sort with digits of \texttt{RADIXBITS} bits. The sorted
+  pairs are then joined with the buckets of the table, which are stored 
+  in the order of their codes. So each bucket is read at most once per
+  block, and the table is read in the order in which it is stored.
+*/
+
+#define BATCHBLOCKSIZE (UintConst(1) << 20)
+#define RADIXBITS      8
+
+struct Codeposition
+{
+  Uint code,        // code of the prefix at the query position
+       querystart;  // the query position
+};
+
+/*
+  The following function sorts \texttt{pairs} by the bits 
+  \texttt{lowbit} to \texttt{codebits}\(-1\) of their codes. It is a
+  least significant digit first radix sort and thus stable. 
+  \texttt{buffer} is used as temporary space.
+*/
+
+static void radixsortbycode(vector<Codeposition> &pairs, vector<Codeposition> &buffer, Uint lowbit, Uint codebits)
+{
+  Uint count[UintConst(1) << RADIXBITS], shift, digit, sum, tmp;
+
+  buffer.resize(pairs.size());
+  for (shift = lowbit; shift < codebits; shift += RADIXBITS)
+  {
+      for (digit = 0; digit < (UintConst(1) << RADIXBITS); digit++)
+          count[digit] = 0;
+      for (vector<Codeposition>::iterator p=pairs.begin(); p!=pairs.end(); ++p)
+          count[((*p).code >> shift) & ((UintConst(1) << RADIXBITS) - 1)]++;
+      for (digit = 0, sum = 0; digit < (UintConst(1) << RADIXBITS); digit++)
+      {
+          tmp = count[digit];
+          count[digit] = sum;
+          sum += tmp;
+      }
+      for (vector<Codeposition>::iterator p=pairs.begin(); p!=pairs.end(); ++p)
+          buffer[count[((*p).code >> shift) & ((UintConst(1) << RADIXBITS) - 1)]++] = *p;
+      pairs.swap(buffer);
+  }
+}
+
+struct Byquerystart
+{
+  bool operator()(const Match_t &a, const Match_t &b) const
+  {
+    return a.Q < b.Q;
+  }
+};
+
+/*
+  In the cache blocked mode, the pairs are only partitioned into bins 
+  by the \texttt{binbits} high order bits of their codes. The bins are 
+  chosen such that the part of the table accessed by the pairs of a
+  bin fits into half of the level 2 cache. The pairs of a bin are probed
+  in the order of the query, while the part of the table stays in the
+  cache. The following function determines \texttt{binbits}.
+*/
+
+#define DEFAULTCACHESIZE (UintConst(1) << 20)
+
+static Uint cacheblockbits(Table &table)
+{
+  long cachesize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  Uint binsize, binbits = 0,
+       tablesize = (Uint) (table.offsets.size() * sizeof (Uint) +
+                           table.suffixes.size() * sizeof (suffix));
+
+  binsize = (cachesize > 0) ? (Uint) cachesize/2 : DEFAULTCACHESIZE/2;
+  while (binbits < 2*table.prefix && (tablesize >> binbits) > binsize)
+      binbits++;
+  return binbits;
+}
+
+/*
+  The following function probes the query positions \texttt{blockstart}
+  to \texttt{blockend}\(-1\) by a sort-merge join. The pairs are sorted 
+  by the \texttt{sortbits} high order bits of their codes, i.e.\ they
+  are completely sorted if \texttt{sortbits} is \(2\cdot\texttt{prefix}\).
+  The sorted pairs are split into segments at boundaries of these bits,
+  which are processed in parallel. Finally the matches are sorted by their query position
+  with a stable sort, so that they are appended to \texttt{A} in the
+  same order as when probing the table in the order of the query.
+*/
+
+static void batchjoin(Table &table, Uint sortbits, Uchar *query, Uchar *blockstart, Uchar *blockend, Uchar *rightq, void **threadreference, Uint referencelen, Uint prefix, Uint minmatchlength, Match_t **A, Uint *N, Uint *Size, Uint *verified, Uint *pruned)
+{
+  vector<Codeposition> pairs, buffer;
+  vector<Uint> segmentstart;
+  vector<Match_t> matches;
+  Codeposition pair;
+  Uchar *leftq;
+  Uint segment, numofsegments, position, sumverified = 0, sumpruned = 0,
+       lowbit = 2*prefix - sortbits;
+  Byquerystart byquerystart;
+
+  for (leftq = blockstart; leftq < blockend && leftq + minmatchlength - 1 <= rightq; leftq++)
+  {
+      pair.code = encoding(leftq,prefix);
+      pair.querystart = (Uint) (leftq-query);
+      pairs.push_back(pair);
+  }
+  if (pairs.empty())
+      return;
+  radixsortbycode(pairs,buffer,lowbit,2*prefix);
+  vector<Codeposition>().swap(buffer);
+  numofsegments = MIN((Uint) (8 * omp_get_max_threads()),(Uint) pairs.size());
+  segmentstart.push_back(0);
+  for (segment = 1; segment < numofsegments; segment++)
+  {
+      position = MAX((Uint) ((double) pairs.size() * segment / numofsegments),segmentstart.back());
+      while (sortbits > 0 && position > 0 && position < (Uint) pairs.size() && 
+             (pairs[position].code >> lowbit) == (pairs[position-1].code >> lowbit))
+          position++;
+      segmentstart.push_back(position);
+  }
+  segmentstart.push_back((Uint) pairs.size());
+  vector<vector<Match_t> > segmentmatches(numofsegments);
+#pragma omp parallel for schedule(dynamic,1) reduction(+:sumverified,sumpruned)
+  for (segment = 0; segment < numofsegments; segment++)
+  {
+      Uchar *reference = (Uchar *) threadreference[omp_get_thread_num()],
+            *rightr = reference + referencelen - 1;
+
+      for (Uint i = segmentstart[segment]; i < segmentstart[segment+1]; i++)
+      {
+          Uint code = pairs[i].code, bucketsize = BUCKETSIZE(&table,code), first, last;
+          suffix *bucket = BUCKETSTART(&table,code);
+
+          if (bucketsize == 0)
+              continue;
+          findmatchrange(bucket,bucketsize,query+pairs[i].querystart,minmatchlength,reference,rightr+1,&first,&last);
+          verifyrange(bucket,first,last,query,query+pairs[i].querystart,rightq,reference,rightr,prefix,minmatchlength,segmentmatches[segment]);
+          sumverified += last - first;
+          sumpruned += bucketsize - (last - first);
+      }
+  }
+  *verified += sumverified;
+  *pruned += sumpruned;
+  for (segment = 0; segment < numofsegments; segment++)
+  {
+      matches.insert(matches.end(),segmentmatches[segment].begin(),segmentmatches[segment].end());
+      vector<Match_t>().swap(segmentmatches[segment]);
+  }
+  stable_sort(matches.begin(),matches.end(),byquerystart);
+  for (vector<Match_t>::iterator m=matches.begin(); m!=matches.end(); ++m)
+      appendmatch(A,N,Size,(Uint) (*m).R-1,(Uint) (*m).Q-1,(Uint) (*m).Len);
+}
+
+/*
+  The following counters accumulate the time and the numbers of verified,
+  pruned and deferred suffixes over all calls of
+  \texttt{findmumcandidates}, which are made one after the other.
+*/
+
+static double probetime = 0.0;
+static Uint probecalls = 0, probeverified = 0, probepruned = 0,
+            probedeferred = 0;
+
+/*EE
+  The following function shows the statistics accumulated by
+  \texttt{findmumcandidates} in one line on stderr, if it was called.
+*/
+
+void showprobestatistics(void)
+{
+  if (probecalls == 0)
+      return;
+  fprintf(stderr,"# Probes=%lu,Time=%f,Verified=%lu,Pruned=%lu,Deferred=%lu\n",
+          (long unsigned int) probecalls,probetime,
+          (long unsigned int) probeverified,(long unsigned int) probepruned,
+          (long unsigned int) probedeferred);
+}
+
 /*EE
   The following function traverses the suffix tree guided by
   some query string. The parameters are as follows:
@@ -300,7 +711,8 @@ static void  Process_Matches (Match_t * A, int N) //  Process matches  A [1 .. N
   \texttt{minmatchlength} is the minimal length of the MUMs as specified
   \item
   \texttt{processmumcandidate} is the function to further process a 
-  MUM-candidate.
+  MUM-candidate. It is applied to the MUM-candidates in parallel, unless
+  it is \texttt{NULL}.
   \item
   \texttt{processinfo} points to some values additionally required by
   the function \texttt{processmumcandidate}.
@@ -322,12 +734,13 @@ static void  Process_Matches (Match_t * A, int N) //  Process matches  A [1 .. N
   0 is returned.
 */
 
-Sint findmumcandidates(Uchar *reference, Uint referencelen, Table &table, Uint minmatchlength, Uint chunks, Uint prefix, Processmatchfunction processmumcandidate, void *processinfo, Uchar *query, Uint querylen, Uint seqnum)
+Sint findmumcandidates(Suffixtree *stree, Table &table, Uint minmatchlength, Uint chunks, Uint prefix, Probeoptions *probeoptions, Processmatchfunction processmumcandidate, void *processinfo, Uchar *query, Uint querylen, Uint seqnum)
 {
-  Uchar *leftq, *rightq = query + querylen - 1, *querysuffix, *leftr, *rightr = reference + referencelen - 1;
+  Uchar *leftq, *rightq = query + querylen - 1, *querysuffix, *leftr, *reference, *rightr;
   double start, end;
-  Uint enc=0, N = 0, Size=32768;
+  Uint enc=0, N = 0, Size=32768, verified = 0, pruned = 0;
   Match_t  *A = NULL;
+  vector<Deferredprobe> deferred;
   /*for (Table::iterator i=table.begin(); i!=table.end(); ++i)
   {
       cout << (*i).first << ":";
@@ -335,44 +748,75 @@ Sint findmumcandidates(Uchar *reference, Uint referencelen, Table &table, Uint m
           cout << ' ' << (*j).position;
       cout << endl;
   }*/
+  vector<void *> threadreference(omp_get_max_threads());
+  threadlocalreplicas((void *) stree->text,threadreference.data());
+  reference = (Uchar *) threadreference[0];
+  rightr = reference + stree->textlen - 1;
   A = (Match_t *) Safe_malloc (Size * sizeof (Match_t));
   /*vector<Uint> v, tmp;
   map<Uint,vector<Uint>> check;*/
   start = omp_get_wtime();
-  for (leftq = query; leftq<rightq-prefix; leftq++) //Iterate query sequence
+  if (probeoptions->batchjoin || probeoptions->cacheblocked)
   {
-      enc = encoding(leftq,prefix);
-      /*v.push_back((Uint) (leftq-query));
-      if (check.count(enc))
-          check[enc].insert(check[enc].end(),v.begin(),v.end());
-      else
-          check[enc]=v;*/
-      if (table.count(enc))
-      {
-          for (Suffixes::iterator i=table[enc].begin(); i!=table[enc].end(); ++i) //Iterate over the suffixes in reference
-          {
-              leftr = reference+(*i).position;
-              if ((leftq == query || leftr == reference || *(leftq-1) != *(leftr-1)) && *(leftq+(*i).depth) == *(leftr+(*i).depth)) //Check left and right maximal
-              {
-          //cout << (Uint) (leftq-query)+1 << '*' << (*i).position+1 << endl;
-              //Uint length = lcp(leftq+(*i).depth+1,rightq,leftr+(*i).depth+1,rightr)+(*i).depth+1;
-                  Uint length = lcp(leftq+prefix,rightq,leftr+prefix,rightr)+prefix;
-                  if (length >= minmatchlength)
-                  {
-                      if (N > Size)
-                      {
-                          Size *= 2;
-                          A = (Match_t *) Safe_realloc (A, Size * sizeof (Match_t));
-                      }  
-                      A[N].R = (*i).position+1;
-                      A[N].Q = (Uint) (leftq-query)+1;
-                      A[N].Len = length;
-                      A[N].Good = true;
-                      N++;
-                  }
-              }
-          }
-      }
+    Uint sortbits = probeoptions->batchjoin ? 2*prefix : cacheblockbits(table);
+    for (leftq = query; leftq<rightq-prefix; leftq += BATCHBLOCKSIZE)
+        batchjoin(table,sortbits,query,leftq,MIN(leftq+BATCHBLOCKSIZE,rightq-prefix),rightq,threadreference.data(),stree->textlen,prefix,minmatchlength,&A,&N,&Size,&verified,&pruned);
+  } else
+  {
+    for (leftq = query; leftq<rightq-prefix; leftq++) //Iterate query sequence
+    {
+        enc = encoding(leftq,prefix);
+        /*v.push_back((Uint) (leftq-query));
+        if (check.count(enc))
+            check[enc].insert(check[enc].end(),v.begin(),v.end());
+        else
+            check[enc]=v;*/
+        Uint bucketsize = BUCKETSIZE(&table,enc), first, last;
+        suffix *suffixes = BUCKETSTART(&table,enc);
+        if (bucketsize == 0)
+            continue;
+        if (leftq + minmatchlength - 1 > rightq)
+            continue;
+        if (probeoptions->bucketcap > 0 && bucketsize > probeoptions->bucketcap)
+        {
+            Deferredprobe probe;
+            probe.code = enc;
+            probe.querystart = (Uint) (leftq-query);
+            probe.matchnum = N;
+            deferred.push_back(probe);
+            continue;
+        }
+        findmatchrange(suffixes,bucketsize,leftq,minmatchlength,reference,rightr+1,&first,&last);
+        verified += last - first;
+        pruned += bucketsize - (last - first);
+        if (last - first < PARALLELBUCKETSIZE)
+        {
+            for (Uint k=first; k < last; k++) //Iterate over the matching range in reference
+            {
+                Uint length = verifysuffix(suffixes[k],query,leftq,rightq,reference,rightr,prefix);
+                if (length >= minmatchlength)
+                    appendmatch(&A,&N,&Size,suffixes[k].position,(Uint) (leftq-query),length);
+            }
+        } else
+        {
+            //Verify blocks of a repetitive range in parallel, keep bucket order
+            Uint numofblocks = (last-first+BUCKETBLOCKSIZE-1)/BUCKETBLOCKSIZE;
+            vector<vector<Match_t> > blockmatches(numofblocks);
+#pragma omp parallel for schedule(dynamic,1)
+            for (Uint block=0; block < numofblocks; block++)
+            {
+                Uchar *threadref = (Uchar *) threadreference[omp_get_thread_num()];
+
+                verifyrange(suffixes,first+block*BUCKETBLOCKSIZE,
+                            MIN(first+(block+1)*BUCKETBLOCKSIZE,last),query,
+                            leftq,rightq,threadref,threadref+stree->textlen-1,
+                            prefix,minmatchlength,blockmatches[block]);
+            }
+            for (Uint block=0; block < numofblocks; block++)
+                for (vector<Match_t>::iterator m=blockmatches[block].begin(); m!=blockmatches[block].end(); ++m)
+                    appendmatch(&A,&N,&Size,(Uint) (*m).R-1,(Uint) (*m).Q-1,(Uint) (*m).Len);
+        }
+    }
   }
   /*Uint comp=0;
   for (map<Uint,vector<Uint>>::iterator i=check.begin();i!=check.end();++i)
@@ -384,8 +828,30 @@ Sint findmumcandidates(Uchar *reference, Uint referencelen, Table &table, Uint m
               cout << (*j).position << ',' << *k << endl;
       }
   }*/
+  if (!deferred.empty())
+      processdeferredprobes(table,deferred,&A,&N,&Size,query,rightq,threadreference.data(),stree->textlen,prefix,minmatchlength,&verified,&pruned);
   end = omp_get_wtime(); 
+  if (processmumcandidate != NULL)
+  {
+      Uint failed = 0;
+#pragma omp parallel for schedule(static) reduction(+:failed)
+      for (Uint i=0; i < N; i++)
+      {
+          if (processmumcandidate(processinfo,(Uint) A[i].Len,(Uint) A[i].R-1,seqnum,(Uint) A[i].Q-1) != 0)
+              failed++;
+      }
+      if (failed > 0)
+      {
+          free(A);
+          return -1;
+      }
+  }
   Process_Matches(A,N);
-  fprintf(stderr,"# Time=%f,",(double) (end-start));
+  free(A);
+  probetime += (double) (end-start);
+  probecalls++;
+  probeverified += verified;
+  probepruned += pruned;
+  probedeferred += (Uint) deferred.size();
   return 0;
 }
@@ -0,0 +1,273 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  gzipfile.cpp
+ *
+ *    Description:  Decompression of gzip and bgzip compressed input files
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 09:05:18
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+//\Ignore{
+
+#include <cstdio>
+#include <cstdlib>
+#include <zlib.h>
+#include "types.h"
+#include "minmax.h"
+#include "spacedef.h"
+#include "protodef.h"
+
+//}
+
+/*EE
+  This file implements the decompression of a subject file which has
+  been compressed by \texttt{gzip} or \texttt{bgzip}. A \texttt{bgzip}
+  file is a sequence of independent gzip members of at most 64KB, whose
+  compressed size is stored in the extra field \texttt{BC} of the header
+  and whose uncompressed size is stored in the trailer. Hence the
+  offset of each block in the uncompressed data is known before any
+  block is decompressed, and the blocks are decompressed in parallel
+  into one buffer. Any other gzip file is decompressed sequentially.
+*/
+
+#define GZIPID1            31
+#define GZIPID2            139
+#define GZIPMETHODDEFLATE  8
+#define GZIPFLAGEXTRA      4
+#define GZIPHEADERSIZE     12   // header without the extra field
+#define GZIPTRAILERSIZE    8    // CRC32 and ISIZE
+#define INFLATECHUNK       (UintConst(1) << 30)
+
+#define LITTLEENDIAN16(P)  ((Uint) (P)[0] | ((Uint) (P)[1] << 8))
+#define LITTLEENDIAN32(P)  (LITTLEENDIAN16(P) | (LITTLEENDIAN16((P)+2) << 16))
+
+/*EE
+  The following function checks if the \texttt{len} bytes at
+  \texttt{content} begin with the magic number of a gzip file.
+*/
+
+bool gzipcompressed(Uchar *content,Uint len)
+{
+  return (len >= UintConst(2) && content[0] == (Uchar) GZIPID1 &&
+          content[1] == (Uchar) GZIPID2) ? true : false;
+}
+
+/*
+  The following function delivers the size of the \texttt{bgzip} block
+  at \texttt{block}, or 0 if \texttt{block} is not the start of a
+  complete \texttt{bgzip} block within the \texttt{remaining} bytes.
+*/
+
+static Uint bgzfblocksize(Uchar *block,Uint remaining)
+{
+  Uint xlen, pos, slen, blocksize;
+
+  if(remaining < GZIPHEADERSIZE || !gzipcompressed(block,remaining) ||
+     block[2] != (Uchar) GZIPMETHODDEFLATE ||
+     !(block[3] & GZIPFLAGEXTRA))
+  {
+    return 0;
+  }
+  xlen = LITTLEENDIAN16(block + 10);
+  if(GZIPHEADERSIZE + xlen > remaining)
+  {
+    return 0;
+  }
+  for(pos = GZIPHEADERSIZE; pos + 4 <= GZIPHEADERSIZE + xlen; pos += 4 + slen)
+  {
+    slen = LITTLEENDIAN16(block + pos + 2);
+    if(block[pos] == (Uchar) 'B' && block[pos+1] == (Uchar) 'C' &&
+       slen == UintConst(2))
+    {
+      blocksize = LITTLEENDIAN16(block + pos + 4) + 1;
+      if(blocksize < GZIPHEADERSIZE + xlen + GZIPTRAILERSIZE ||
+         blocksize > remaining)
+      {
+        return 0;
+      }
+      return blocksize;
+    }
+  }
+  return 0;
+}
+
+/*
+  The following function decompresses the \texttt{bgzip} blocks
+  of \texttt{content} in parallel. If \texttt{content} is not a
+  sequence of \texttt{bgzip} blocks, then \texttt{NULL} is returned
+  and \texttt{*isbgzf} is set to false.
+*/
+
+static Uchar *inflatebgzf(char *filename,Uchar *content,Uint len,
+                          Uint *outlen,bool *isbgzf)
+{
+  Uint pos, blocksize, numofblocks = 0, block, *blockstart, *outstart;
+  Sint failures = 0;
+  Uchar *out;
+
+  *isbgzf = false;
+  for(pos = 0; pos < len; pos += blocksize, numofblocks++)
+  {
+    blocksize = bgzfblocksize(content + pos,len - pos);
+    if(blocksize == 0)
+    {
+      return NULL;
+    }
+  }
+  *isbgzf = true;
+  blockstart = ALLOCSPACE(NULL,Uint,numofblocks+1);
+  outstart = ALLOCSPACE(NULL,Uint,numofblocks+1);
+  blockstart[0] = outstart[0] = 0;
+  for(block = 0; block < numofblocks; block++)
+  {
+    blockstart[block+1] = blockstart[block]
+                        + bgzfblocksize(content + blockstart[block],
+                                        len - blockstart[block]);
+    outstart[block+1] = outstart[block]
+                      + LITTLEENDIAN32(content + blockstart[block+1] - 4);
+  }
+  *outlen = outstart[numofblocks];
+  out = ALLOCSPACE(NULL,Uchar,*outlen+1);
+#pragma omp parallel for schedule(dynamic,64) reduction(+:failures)
+  for(block = 0; block < numofblocks; block++)
+  {
+    Uchar *data = content + blockstart[block];
+    Uint isize = outstart[block+1] - outstart[block],
+         xlen = LITTLEENDIAN16(data + 10);
+    z_stream strm;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = data + GZIPHEADERSIZE + xlen;
+    strm.avail_in = (uInt) (blockstart[block+1] - blockstart[block]
+                            - GZIPHEADERSIZE - xlen - GZIPTRAILERSIZE);
+    strm.next_out = out + outstart[block];
+    strm.avail_out = (uInt) isize;
+    if(inflateInit2(&strm,-MAX_WBITS) != Z_OK)
+    {
+      failures++;
+      continue;
+    }
+    if(inflate(&strm,Z_FINISH) != Z_STREAM_END || strm.total_out != isize ||
+       crc32(crc32(0L,Z_NULL,0),out + outstart[block],(uInt) isize)
+         != LITTLEENDIAN32(data + blockstart[block+1] - blockstart[block]
+                                - GZIPTRAILERSIZE))
+    {
+      failures++;
+    }
+    (void) inflateEnd(&strm);
+  }
+  FREESPACE(blockstart);
+  FREESPACE(outstart);
+  if(failures > 0)
+  {
+    fprintf(stderr,"file \"%s\": %ld corrupt bgzip blocks\n",filename,
+            (long int) failures);
+    FREESPACE(out);
+    return NULL;
+  }
+  return out;
+}
+
+/*
+  The following function decompresses a gzip file, which may consist
+  of several members, sequentially into a buffer which is doubled
+  whenever it is full.
+*/
+
+static Uchar *inflategzip(char *filename,Uchar *content,Uint len,
+                          Uint *outlen)
+{
+  Uint outsize = MAX(UintConst(4) * len,UintConst(1) << 20), consumed = 0;
+  Uchar *out = ALLOCSPACE(NULL,Uchar,outsize+1);
+  z_stream strm;
+  int ret = Z_OK;
+
+  strm.zalloc = Z_NULL;
+  strm.zfree = Z_NULL;
+  strm.opaque = Z_NULL;
+  strm.next_in = content;
+  strm.avail_in = 0;
+  if(inflateInit2(&strm,MAX_WBITS + 16) != Z_OK)
+  {
+    fprintf(stderr,"file \"%s\": cannot initialize zlib\n",filename);
+    FREESPACE(out);
+    return NULL;
+  }
+  *outlen = 0;
+  while(true)
+  {
+    if(strm.avail_in == 0)
+    {
+      strm.avail_in = (uInt) MIN(len - consumed,INFLATECHUNK);
+      consumed += strm.avail_in;
+    }
+    if(*outlen == outsize)
+    {
+      outsize *= 2;
+      out = ALLOCSPACE(out,Uchar,outsize+1);
+    }
+    strm.next_out = out + *outlen;
+    strm.avail_out = (uInt) MIN(outsize - *outlen,INFLATECHUNK);
+    ret = inflate(&strm,Z_NO_FLUSH);
+    *outlen = (Uint) (strm.next_out - out);
+    if(ret == Z_STREAM_END)
+    {
+      if(strm.avail_in == 0 && consumed == len)
+      {
+        break;
+      }
+      (void) inflateReset(&strm);
+    } else
+    {
+      if(ret != Z_OK && ret != Z_BUF_ERROR)
+      {
+        break;
+      }
+      if(ret == Z_BUF_ERROR && strm.avail_in == 0 && consumed == len)
+      {
+        break;
+      }
+    }
+  }
+  (void) inflateEnd(&strm);
+  if(ret != Z_STREAM_END)
+  {
+    fprintf(stderr,"file \"%s\": corrupt or truncated gzip data\n",filename);
+    FREESPACE(out);
+    return NULL;
+  }
+  return out;
+}
+
+/*EE
+  The following function decompresses the \texttt{len} bytes of the
+  gzip or \texttt{bgzip} compressed file \texttt{filename} stored at
+  \texttt{content}. It returns a buffer of \texttt{*outlen} bytes
+  (with one additional byte) allocated via \texttt{ALLOCSPACE}, or
+  \texttt{NULL} if the data is corrupt.
+*/
+
+Uchar *inflatefilecontent(char *filename,Uchar *content,Uint len,
+                          Uint *outlen)
+{
+  Uchar *out;
+  bool isbgzf;
+
+  out = inflatebgzf(filename,content,len,outlen,&isbgzf);
+  if(isbgzf)
+  {
+    return out;
+  }
+  return inflategzip(filename,content,len,outlen);
+}
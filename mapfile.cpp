@@ -18,12 +18,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <cstring>
+#include <atomic>
 #include "types.h"
 #include "errordef.h"
 #include "protodef.h"
 
-#define MAXMAPPEDFILES 64
-
 using namespace std;
 //}
 
@@ -45,50 +44,87 @@ using namespace std;
 */
 
 /*
-  Pointers to the memory areas, initialized to NULL, i.e. not occupied.
+  The memory maps are registered in a table indexed by the file
+  descriptor. Each entry stores the pointer to the memory area, which
+  is \texttt{NULL} if the entry is not occupied, the size of the map, and
+  the file and line where the map was created, to generate meaningfull
+  error messages. Since the number of open files is not bounded, the
+  table is enlarged whenever a file descriptor beyond its end is
+  mapped. Since files may be mapped by several threads at the same time,
+  the table is only accessed in a critical section.
 */
 
-static void *memoryptr[MAXMAPPEDFILES] = {NULL};
+typedef struct
+{
+  void *memoryptr;      // the mapped memory area
+  Uint mappedbytes;     // size of the memory map
+  char *filemapped;     // file where the mmap was created
+  Uint linemapped;      // line where the mmap was created
+} Mappedfile;
 
-static Uint currentspace = 0,              // currently mapped num of bytes
-            spacepeak = 0,                 // maximally mapped num of bytes
-            mappedbytes[MAXMAPPEDFILES] = {0};  // size of the memory map
+static Mappedfile *mappedfiles = NULL;
+static Uint allocatedmappedfiles = 0;
 
-/*
-  The following two tables store important information to
-  generate meaningfull error messages.
-*/
+#define MAPPEDFILESINCREMENT 64
 
+static atomic<Uint> currentspace(0),       // currently mapped num of bytes
+                    spacepeak(0);          // maximally mapped num of bytes
 
 /*
-  file where the mmap was created
+  The following function makes sure that the table has an entry
+  for file descriptor \texttt{fd}. It returns false if the space 
+  for the table cannot be allocated.
 */
 
-static char *filemapped[MAXMAPPEDFILES] = {NULL};  
-
-/*
-  line where the mmap was created
-*/
+static bool registermappedfile(Sint fd)
+{
+  Uint newsize, i;
+  Mappedfile *newtable;
 
-static Uint linemapped[MAXMAPPEDFILES] = {0};       
+  if((Uint) fd < allocatedmappedfiles)
+  {
+    return true;
+  }
+  newsize = (Uint) fd + MAPPEDFILESINCREMENT;
+  newtable = (Mappedfile *) realloc(mappedfiles,
+                                    (size_t) newsize * sizeof(Mappedfile));
+  if(newtable == NULL)
+  {
+    return false;
+  }
+  for(i = allocatedmappedfiles; i < newsize; i++)
+  {
+    newtable[i].memoryptr = NULL;
+    newtable[i].mappedbytes = 0;
+    newtable[i].filemapped = NULL;
+    newtable[i].linemapped = 0;
+  }
+  mappedfiles = newtable;
+  allocatedmappedfiles = newsize;
+  return true;
+}
 
 /*
   The following two functions \texttt{mmaddspace} and \texttt{mmsubtractspace} 
   maintain the variables \texttt{currentspace} and \texttt{spacepeak}.
+  Since files may be mapped by several threads at the same time, both
+  are atomic.
 */
 
 static void mmaddspace(Uint space)
 {
-  currentspace += space;
-  if(currentspace > spacepeak)
+  Uint current = currentspace.fetch_add(space) + space,
+       peak = spacepeak.load();
+
+  while(current > peak && !spacepeak.compare_exchange_weak(peak,current))
   {
-    spacepeak = currentspace;
+    /* Nothing */ ;
   }
 }
 
 static void mmsubtractspace(Uint space)
 {
-  currentspace -= space;
+  currentspace.fetch_sub(space);
 }
 
 /*EE
@@ -142,33 +178,49 @@ Sint simplefileOpen(char *filename,Uint *numofbytes)
     cerr << "creatememorymap: filedescriptor " << (Sint) fd << " negative" << endl;
     return NULL;
   }
-  if(fd >= MAXMAPPEDFILES)
+  void *memoryptr;
+  bool occupied = false, registered;
+
+#pragma omp critical(mappedfiles)
+  {
+    registered = registermappedfile(fd);
+    if(registered)
+    {
+      occupied = (mappedfiles[fd].memoryptr != NULL);
+    }
+  }
+  if(!registered)
   {
-    cerr << "creatememorymap: filedescriptor " << (Sint) fd << " is too large" << endl;
+    cerr << "creatememorymap: cannot register filedescriptor " << (Sint) fd << endl;
     return NULL;
   }
-  if(memoryptr[fd] != NULL)
+  if(occupied)
   {
     cerr << "creatememorymap: filedescriptor " << (Sint) fd << " already in use" << endl;
     return NULL;
   }
-  mmaddspace(numofbytes);
-  mappedbytes[fd] = numofbytes;
-  memoryptr[fd] 
+  memoryptr
     = (void *) mmap(0,
                     (size_t) numofbytes,
                     writemap ? (PROT_READ | PROT_WRITE) : PROT_READ,
                     MAP_PRIVATE,
                     fd,
                     (off_t) 0);
-  if(memoryptr[fd] == (void *) MAP_FAILED)
+  if(memoryptr == (void *) MAP_FAILED)
   {
     cerr << "memorymapping for filedescripto " << (Sint) fd << " failed" << endl;
     return NULL;
   }
-  filemapped[fd] = file;
-  linemapped[fd] = line;
-  return memoryptr[fd];
+  mmaddspace(numofbytes);
+  applymempolicy(memoryptr,numofbytes);
+#pragma omp critical(mappedfiles)
+  {
+    mappedfiles[fd].memoryptr = memoryptr;
+    mappedfiles[fd].mappedbytes = numofbytes;
+    mappedfiles[fd].filemapped = file;
+    mappedfiles[fd].linemapped = line;
+  }
+  return memoryptr;
 }
 
 /*EE
@@ -198,41 +250,47 @@ Sint simplefileOpen(char *filename,Uint *numofbytes)
 
 Sint deletememorymap(char *file,Uint line,void *mappedfile)
 {
-  int fd;
+  Sint fd, foundfd = -1;
+  Mappedfile entry;
 
   if(mappedfile == NULL)
   {
     //cerr << file << ": l. " << (Sint) line << ": deletememorymap: mappedfile is NULL" << endl;
     return -1;
   }
-  for(fd=0; fd<MAXMAPPEDFILES; fd++)
+#pragma omp critical(mappedfiles)
   {
-    if(memoryptr[fd] == mappedfile)
+    for(fd=0; fd<(Sint) allocatedmappedfiles; fd++)
     {
-      break;
+      if(mappedfiles[fd].memoryptr == mappedfile)
+      {
+        foundfd = fd;
+        entry = mappedfiles[fd];
+        mappedfiles[fd].memoryptr = NULL;
+        mappedfiles[fd].mappedbytes = 0;
+        break;
+      }
     }
   }
-  if(fd == MAXMAPPEDFILES)
+  if(foundfd < 0)
   {
     //cerr <<  file << ": l. " << (Sint) line << ": deletememorymap: cannot find filedescriptor for given address" << endl;
     return -2;
   }
-  if(munmap(memoryptr[fd],(size_t) mappedbytes[fd]) != 0)
+  if(munmap(entry.memoryptr,(size_t) entry.mappedbytes) != 0)
   {
     fprintf(stderr, "%s: l. %ld: deletememorymap: munmap failed:"
             " mapped in file \"%s\",line %lu",
             file,
             (Sint) line,
-            filemapped[fd],
-            (Uint) linemapped[fd]);
+            entry.filemapped,
+            (Uint) entry.linemapped);
     return -3;
   }
-  memoryptr[fd] = NULL;
-  mmsubtractspace(mappedbytes[fd]);
-  mappedbytes[fd] = 0;
-  if(close(fd) != 0)
+  mmsubtractspace(entry.mappedbytes);
+  if(close((int) foundfd) != 0)
   {
-    fprintf(stderr,"cannot close file \"%s\"",filemapped[fd]);
+    fprintf(stderr,"cannot close file \"%s\"",entry.filemapped);
     return -4;
   }
   return 0;
@@ -248,17 +306,17 @@ Sint deletememorymap(char *file,Uint line,void *mappedfile)
 
 void mmcheckspaceleak(void)
 {
-  int fd;
+  Uint fd;
 
-  for(fd=0; fd<MAXMAPPEDFILES; fd++)
+  for(fd=0; fd<allocatedmappedfiles; fd++)
   {
-    if(memoryptr[fd] != NULL)
+    if(mappedfiles[fd].memoryptr != NULL)
     {
       fprintf(stderr,"space leak: memory for filedescriptor %ld not freed\n",
               (Sint) fd);
       fprintf(stderr,"mapped in file \"%s\", line %lu\n",
-              filemapped[fd],
-              (Uint) linemapped[fd]);
+              mappedfiles[fd].filemapped,
+              (Uint) mappedfiles[fd].linemapped);
       exit(EXIT_FAILURE);
     }
   }
@@ -266,37 +324,41 @@ void mmcheckspaceleak(void)
 
 /*EE
   The following function frees the space for all memory maps
-  which have not already been unmapped.
+  which have not already been unmapped, and the table of the
+  memory maps.
 */
 
 Sint mmwrapspace(void)
 {
-  int fd;
+  Uint fd;
 
-  for(fd=0; fd<MAXMAPPEDFILES; fd++)
+  for(fd=0; fd<allocatedmappedfiles; fd++)
   {
-    if(memoryptr[fd] != NULL)
+    if(mappedfiles[fd].memoryptr != NULL)
     {
-      if(munmap(memoryptr[fd],(size_t) mappedbytes[fd]) != 0)
+      if(munmap(mappedfiles[fd].memoryptr,
+                (size_t) mappedfiles[fd].mappedbytes) != 0)
       {
         fprintf (stderr, "mmwrapspace: munmap failed: mapped in file \"%s\", line %lu",
-               filemapped[fd],
-               (Uint) linemapped[fd]);
+               mappedfiles[fd].filemapped,
+               (Uint) mappedfiles[fd].linemapped);
         return -1;
       }
-      memoryptr[fd] = NULL;
-      if(close(fd) != 0)
+      mappedfiles[fd].memoryptr = NULL;
+      if(close((int) fd) != 0)
       {
-        fprintf(stderr,"cannot close file \"%s\"",filemapped[fd]);
+        fprintf(stderr,"cannot close file \"%s\"",mappedfiles[fd].filemapped);
         return -4;
       }
-      mmsubtractspace(mappedbytes[fd]);
-      memoryptr[fd] = NULL;
-      mappedbytes[fd] = 0;
-      filemapped[fd] = NULL;
-      linemapped[fd] = 0;
+      mmsubtractspace(mappedfiles[fd].mappedbytes);
+      mappedfiles[fd].mappedbytes = 0;
+      mappedfiles[fd].filemapped = NULL;
+      mappedfiles[fd].linemapped = 0;
     }
   }
+  free(mappedfiles);
+  mappedfiles = NULL;
+  allocatedmappedfiles = 0;
   return 0;
 }
 
@@ -21,13 +21,38 @@
 #include "mumcand.h"
 #include "protodef.h"
 
+/*
+  The suffixes in a bucket of the table are sorted lexicographically.
+  \texttt{lcp} is the length of the longest common prefix of the suffix
+  and the previous suffix in the same bucket, but at most the minimum 
+  match length. It is 0 for the first suffix of a bucket.
+*/
+
 struct suffix
 {
-    Uint depth, position;
+    Uint depth, position, lcp;
 };
 
 typedef vector<suffix> Suffixes;
-typedef map<Uint, Suffixes > Table;
+
+/*
+  The table stores the suffixes in buckets according to the code of
+  their first \texttt{prefix} characters. All buckets are stored one after
+  the other in \texttt{suffixes}, ordered by their code. The bucket of code 
+  \(c\) consists of the suffixes \(\texttt{offsets}[c]\) to 
+  \(\texttt{offsets}[c+1]-1\).
+*/
+
+struct Table
+{
+  Uint prefix,            // length of the prefixes
+       numofcodes;        // number of codes, i.e.\ \(4^{\texttt{prefix}}\)
+  vector<Uint> offsets;   // start of the buckets, \texttt{numofcodes}+1 values
+  Suffixes suffixes;      // the buckets
+};
+
+#define BUCKETSTART(T,C)  ((T)->suffixes.data() + (T)->offsets[C])
+#define BUCKETSIZE(T,C)   ((T)->offsets[(C)+1] - (T)->offsets[C])
 //}
 
 /*
@@ -46,10 +71,23 @@ typedef map<Uint, Suffixes > Table;
 #define MMREPLACEMENTCHARQUERY   (WILDCARD-3)
 
 /*
-  The maximal number of query files.
+  The following type contains the options controlling how the
+  table is probed.
 */
 
-#define MAXNUMOFQUERYFILES       32
+struct Probeoptions
+{
+  Uint hybridthreshold,         // largest bucket verified in hybrid mode
+       bucketcap,               // larger buckets are verified deferred
+       minimizerwindow,         // if > 0, index only the minimizers
+       sparsestep;              // if > 0, index only every step-th suffix
+  bool batchjoin,               // probe the table by a sort-merge join
+       cacheblocked,            // probe the table in cache sized bins
+       leafcounts;              // find MUM-candidates by the suffix tree
+                                // and the number of leaves below nodes
+  Packedseq *packedtext;        // NULL or the packed subject-sequence,
+                                // which then replaces the text
+};                   // \Typedef{Probeoptions}
 
 /*
   The following type contains all information
@@ -59,6 +97,7 @@ typedef map<Uint, Suffixes > Table;
 struct MMcallinfo
 {
   bool showstring,              // show the matching string
+       verbose,                 // show statistics on stderr
        reversecomplement,       // compute matches on reverse strand
        forward,                 // compute matches on forward strand
        fourcolumn,              // always use 4 column format
@@ -67,15 +106,26 @@ struct MMcallinfo
        matchnucleotidesonly,    // match ONLY acgt's
        cmaxmatch,               // compute all maximal matches
        cmumcand,                // compute reference-unique maximal matches
-       cmum;                    // compute real matches unique in both sequences
+       cmum,                    // compute real matches unique in both sequences
+       hugepages,               // back large tables by huge pages
+       packsubject,             // store the subject with 2 bits per base
+       rcindex,                 // index the reverse complemented subject
+       shards;                  // the subject file lists shard files
+  Numapolicy numapolicy;        // NUMA placement of large tables
   Uint minmatchlength,          // minimal length of a match to be reported
        chunks,                  // number of chunks to split query sequence
        prefix,                  // length of prefix for Direct Access Table
-       numofqueryfiles;         // number of query files
+       numofqueryfiles,         // number of query files
+       allocatedqueryfiles,     // number of entries allocated for the list
+       numofshards,             // number of shard files
+       allocatedshards,         // number of entries allocated for the list
+       *shardstart;             // start of each shard, then total length+1
+  Probeoptions probeoptions;    // options for probing the table
   char program[PATH_MAX+1],     // the path of the program
        subjectfile[PATH_MAX+1], // filename of the subject-sequence
-       queryfilelist[MAXNUMOFQUERYFILES][PATH_MAX+1]; 
-                                // filenames of the query-sequences
+       manifestfile[PATH_MAX+1],// file listing query files or empty
+       **queryfilelist,         // filenames of the query-sequences
+       **shardfilelist;         // filenames of the shards of the subject
 };                   // \Typedef{MMcallinfo}
 
 /*EE
@@ -88,15 +138,24 @@ struct Matchprocessinfo
   Suffixtree stree;            // the suffix tree of the subject-sequence
   Multiseq *subjectmultiseq,   // reference to multiseq of subject
            querymultiseq;      // the Multiseq record of the queries
-  ArrayMUMcandidate mumcandtab;// a table containing MUM-candidates
+  ArrayMUMcandidate mumcandtab,// a table containing MUM-candidates
                                // when option \texttt{-mum} is on
+                    *threadmumcandtab; // one such table per thread
   Uint minmatchlength,         // minimum length of a match
        maxdesclength,          // maximum length of a description
        chunks,                 //  number of chunks to split query sequence
        prefix,                  // length of prefix for Direct Access Table
-       currentquerylen;        // length of the current query sequence
+       currentquerylen,        // length of the current query sequence
+       numofthreads,           // number of tables in \texttt{threadmumcandtab}
+       numofshards,            // 0 or the number of shards of the subject
+       *shardstart;            // start of each shard, then total length+1
+  char **shardfilelist;        // the files of the shards
   Table table;                 // Table to quickly discard suffixes
+  Probeoptions probeoptions;   // options for probing the table
+  ArrayThreeUint forwardmatches,// with rcindex, the matches on each
+                 reversematches;// strand of the current query
   bool showstring,             // is option \texttt{-s} on?
+       verbose,                // is option \texttt{-verbose} on?
        showsequencelengths,    // is option \texttt{-L} on?
        showreversepositions,   // is option \texttt{-c} on?
        forward,                // compute forward matches
@@ -104,6 +163,7 @@ struct Matchprocessinfo
        reversecomplement,      // compute reverse complement matches
        cmumcand,               // compute MUM candidates
        cmum,                   // compute MUMs
+       rcindex,                // the reverse complement is indexed
        currentisrcmatch;       // true iff currently rc-matches are computed
 };  
 
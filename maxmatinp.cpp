@@ -11,7 +11,14 @@
 #include <cstdio>
 #include <cstdlib>
 #include <ctype.h>
+#include <string.h>
 #include <iostream>
+#include <omp.h>
+#include <zlib.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#include "minmax.h"
 #include "chardef.h"
 #include "spacedef.h"
 #include "protodef.h"
@@ -44,6 +51,412 @@
         multiseq->startdesc[multiseq->numofsequences]\
           = multiseq->descspace.nextfreeUchar
 
+/*
+  The following function stores the description following the symbol
+  \texttt{>} at \texttt{descstart} up to the first white space character 
+  in \texttt{descspace}, terminated by a newline if the white space 
+  character is found. The description is copied at once, after the 
+  space for it is checked. The rest of the line is skipped by 
+  \texttt{memchr}. The function returns a pointer to the character 
+  after the newline ending the line, or \texttt{inputend}.
+*/
+
+static Uchar *scandescription(Multiseq *multiseq,Uchar *descstart,
+                              Uchar *inputend)
+{
+  Uchar *descend, *lineend;
+
+  for(descend = descstart; descend < inputend && !isspace((int) *descend); 
+      descend++)
+    /* Nothing */ ;
+  CHECKARRAYSPACEMULTI(&multiseq->descspace,Uchar,
+                       (Uint) (descend - descstart) + 1);
+  memcpy(multiseq->descspace.spaceUchar + multiseq->descspace.nextfreeUchar,
+         descstart,(size_t) (descend - descstart));
+  multiseq->descspace.nextfreeUchar += (Uint) (descend - descstart);
+  if(descend == inputend)
+  {
+    return inputend;
+  }
+  multiseq->descspace.spaceUchar[multiseq->descspace.nextfreeUchar++] 
+    = (Uchar) '\n';
+  lineend = (Uchar *) memchr(descend,'\n',(size_t) (inputend - descend));
+  return (lineend == NULL) ? inputend : lineend + 1;
+}
+
+#ifdef __SSSE3__
+
+/*
+  The sequence part of the input is transformed in blocks of 16 
+  characters with SSSE3 instructions. The white space characters of a
+  block are found by comparisons with the blank and the range of the
+  control characters from tab to carriage return,
+  the upper case characters are converted by adding 32, and the 
+  remaining characters are compacted by shuffling each half of the 
+  block according to the following table. Row \(m\) contains the indices
+  of the set bits of \(m\) in increasing order. Since the compacted
+  characters are never stored behind the current block, the 
+  transformation is done in place. A block containing the symbol 
+  \texttt{>} or, if \texttt{validate} is true, a character other than
+  a, c, g, t or white space, is left to the scalar parser.
+*/
+
+static Uchar compactindex[256][8];
+
+static void initcompactindex(void)
+{
+  static bool initialized = false;
+  Uint mask, bit, count;
+
+  if(initialized)
+  {
+    return;
+  }
+  for(mask = 0; mask < UintConst(256); mask++)
+  {
+    count = 0;
+    for(bit = 0; bit < UintConst(8); bit++)
+    {
+      if(mask & (UintConst(1) << bit))
+      {
+        compactindex[mask][count++] = (Uchar) bit;
+      }
+    }
+    while(count < UintConst(8))
+    {
+      compactindex[mask][count++] = (Uchar) 0x80;
+    }
+  }
+  initialized = true;
+}
+
+#define SEQUENCEBLOCKSIZE 16
+
+static inline bool scansequenceblock(Uchar *inputptr,Uchar **newptr,
+                                     bool validate)
+{
+  __m128i block = _mm_loadu_si128((__m128i *) inputptr),
+          space, upper, keep, control;
+  Uint keepmask;
+
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(block,
+                                      _mm_set1_epi8(FASTASEPARATOR))) != 0)
+  {
+    return false;
+  }
+  space = _mm_or_si128(_mm_cmpeq_epi8(block,_mm_set1_epi8(' ')),
+            _mm_and_si128(_mm_cmpgt_epi8(block,_mm_set1_epi8('\t' - 1)),
+                          _mm_cmplt_epi8(block,_mm_set1_epi8('\r' + 1))));
+  upper = _mm_and_si128(_mm_cmpgt_epi8(block,_mm_set1_epi8('A' - 1)),
+                        _mm_cmplt_epi8(block,_mm_set1_epi8('Z' + 1)));
+  block = _mm_add_epi8(block,_mm_and_si128(upper,_mm_set1_epi8(32)));
+  if(validate)
+  {
+    __m128i valid = _mm_or_si128(
+                      _mm_or_si128(_mm_cmpeq_epi8(block,_mm_set1_epi8('a')),
+                                   _mm_cmpeq_epi8(block,_mm_set1_epi8('c'))),
+                      _mm_or_si128(_mm_cmpeq_epi8(block,_mm_set1_epi8('g')),
+                                   _mm_cmpeq_epi8(block,_mm_set1_epi8('t'))));
+
+    if(_mm_movemask_epi8(_mm_or_si128(valid,space)) != 0xFFFF)
+    {
+      return false;
+    }
+  }
+  keepmask = (Uint) (~_mm_movemask_epi8(space) & 0xFFFF);
+  if(keepmask == 0xFFFF)
+  {
+    _mm_storeu_si128((__m128i *) *newptr,block);
+    *newptr += SEQUENCEBLOCKSIZE;
+    return true;
+  }
+  keep = _mm_loadl_epi64((__m128i *) compactindex[keepmask & 0xFF]);
+  control = _mm_unpacklo_epi64(keep,
+              _mm_add_epi8(_mm_loadl_epi64((__m128i *) 
+                                           compactindex[keepmask >> 8]),
+                           _mm_set1_epi8(8)));
+  block = _mm_shuffle_epi8(block,control);
+  _mm_storel_epi64((__m128i *) *newptr,block);
+  *newptr += __builtin_popcount((unsigned int) (keepmask & 0xFF));
+  _mm_storel_epi64((__m128i *) *newptr,_mm_srli_si128(block,8));
+  *newptr += __builtin_popcount((unsigned int) (keepmask >> 8));
+  return true;
+}
+
+#endif
+
+/*
+  The following function scans the range of \texttt{inputlen} characters
+  starting at \texttt{input} as described for 
+  \texttt{scanmultiplefastafile} below and stores the result in 
+  \texttt{multiseq}. The sequence is compacted in place, i.e.\ it begins
+  at \texttt{input}. If \texttt{afterrecord} is true, then the range is
+  not the first range of the input, and a separator is stored for
+  its first record, too.
+*/
+
+static void scanfastarange (Multiseq *multiseq,
+                            char *filename,
+                            Uchar replacewildcardchar,
+                            Uchar *input,
+                            Uint inputlen,
+                            bool afterrecord)
+{
+  Uchar *inputptr,      // points to a suffix of the input
+        *inputend = input + inputlen,
+        *newptr,        // points to the transform,ed
+        tmpchar;        // temporary character
+  Uint allocatedstartdesc = 0;  // num of characters allocated for startdesc
+#ifdef __SSSE3__
+#ifdef WARNINGIFNONUCLEOTIDES
+  bool validate = true;
+#else
+  bool validate = (replacewildcardchar != 0);
+#endif
+#endif
+
+  initmultiseq (multiseq);
+  multiseq->originalsequence = NULL;
+
+  newptr = multiseq->sequence = input;
+  inputptr = input;
+  while (inputptr < inputend)
+  {
+    if (*inputptr == FASTASEPARATOR)
+    {
+      STORESTARTDESC;
+      if (multiseq->numofsequences > 0 || afterrecord)
+      {
+        STOREINARRAY (&multiseq->markpos, 
+                      Uint,
+                      128,
+                      (Uint) (newptr - multiseq->sequence));
+
+        *newptr++ = SEPARATOR;
+      }
+      multiseq->numofsequences++;
+      inputptr = scandescription(multiseq,inputptr+1,inputend);
+      continue;
+    }
+#ifdef __SSSE3__
+    if (inputptr + SEQUENCEBLOCKSIZE <= inputend &&
+        scansequenceblock(inputptr,&newptr,validate))
+    {
+      inputptr += SEQUENCEBLOCKSIZE;
+      continue;
+    }
+#endif
+    tmpchar = *inputptr++;
+    if (!isspace ((int) tmpchar))
+    {
+      tmpchar = (Uchar) tolower ((int) tmpchar);
+      if (replacewildcardchar != 0)  // replace wildcards
+      {
+        switch (tmpchar)
+        {
+          case 'a':
+          case 'c':
+          case 'g':
+          case 't':
+            break;
+          default:
+               fprintf(stderr,"filename %s: replace '%c' by '%c'\n",
+               filename,tmpchar,replacewildcardchar);
+            tmpchar = replacewildcardchar;
+        }
+      }
+#ifdef WARNINGIFNONUCLEOTIDES
+      else
+      {
+        switch (tmpchar)
+        {
+          case 'a':
+          case 'c':
+          case 'g':
+          case 't':
+          case 's':
+          case 'w':
+          case 'r':
+          case 'y':
+          case 'm':
+          case 'k':
+          case 'b':
+          case 'd':
+          case 'h':
+          case 'v':
+          case 'n':
+            break;
+          default:
+            fprintf (stderr,
+                     "Unexpected character '%c\' in string %s\n",
+                     tmpchar, filename);
+            tmpchar = 'n';
+        }
+      }
+#endif
+      *newptr++ = tmpchar;
+    }
+  }
+  STORESTARTDESC;
+  multiseq->totallength = (Uint) (newptr - multiseq->sequence);
+}
+
+/*
+  Large inputs are scanned in parallel. The input is split into 
+  ranges of about equal size, where each range except for the first 
+  begins with the symbol \texttt{>} at the start of a line. Such a
+  symbol is never part of a description and hence always starts a
+  record, so that the ranges can be scanned independently. The 
+  following function delivers the start of the range following the
+  position \texttt{splitpos}.
+*/
+
+#define MINPARALLELINPUT (UintConst(1) << 20)
+
+static Uchar *nextrecordstart(Uchar *splitpos,Uchar *inputend)
+{
+  Uchar *lineend;
+
+  for(lineend = splitpos; lineend < inputend; lineend++)
+  {
+    lineend = (Uchar *) memchr(lineend,'\n',(size_t) (inputend - lineend));
+    if(lineend == NULL)
+    {
+      break;
+    }
+    if(lineend + 1 < inputend && lineend[1] == FASTASEPARATOR)
+    {
+      return lineend + 1;
+    }
+  }
+  return inputend;
+}
+
+/*
+  The following function joins the results of the \texttt{numofranges}
+  ranges in \texttt{ranges} into \texttt{multiseq}. The offsets of 
+  the ranges in the sequence, the descriptions and the record numbers
+  are computed as prefix sums. The separator stored for the first 
+  record of a range is dropped if no record precedes the range. The 
+  sequence parts are moved to their final place in order of the ranges,
+  since a part may be moved into the space of a preceding range. The
+  positions and descriptions are copied in parallel.
+*/
+
+static void stitchfastaranges(Multiseq *multiseq,Uchar *input,
+                              Multiseq *ranges,Uint numofranges)
+{
+  Uint r, *seqoffset, *markoffset, *descoffset, *recordoffset, *dropsep;
+
+  seqoffset = ALLOCSPACE(NULL,Uint,numofranges+1);
+  markoffset = ALLOCSPACE(NULL,Uint,numofranges+1);
+  descoffset = ALLOCSPACE(NULL,Uint,numofranges+1);
+  recordoffset = ALLOCSPACE(NULL,Uint,numofranges+1);
+  dropsep = ALLOCSPACE(NULL,Uint,numofranges);
+  seqoffset[0] = markoffset[0] = descoffset[0] = recordoffset[0] = 0;
+  for(r = 0; r < numofranges; r++)
+  {
+    dropsep[r] = (r > 0 && ranges[r].numofsequences > 0 && 
+                  recordoffset[r] == 0) ? UintConst(1) : 0;
+    seqoffset[r+1] = seqoffset[r] + ranges[r].totallength - dropsep[r];
+    markoffset[r+1] = markoffset[r] + ranges[r].markpos.nextfreeUint 
+                                    - dropsep[r];
+    descoffset[r+1] = descoffset[r] + ranges[r].descspace.nextfreeUchar;
+    recordoffset[r+1] = recordoffset[r] + ranges[r].numofsequences;
+  }
+  initmultiseq(multiseq);
+  multiseq->sequence = input;
+  multiseq->numofsequences = recordoffset[numofranges];
+  multiseq->totallength = seqoffset[numofranges];
+  multiseq->startdesc = ALLOCSPACE(NULL,Uint,multiseq->numofsequences+1);
+  multiseq->startdesc[multiseq->numofsequences] = descoffset[numofranges];
+  CHECKARRAYSPACEMULTI(&multiseq->markpos,Uint,markoffset[numofranges]);
+  multiseq->markpos.nextfreeUint = markoffset[numofranges];
+  CHECKARRAYSPACEMULTI(&multiseq->descspace,Uchar,descoffset[numofranges]);
+  multiseq->descspace.nextfreeUchar = descoffset[numofranges];
+  for(r = 0; r < numofranges; r++)
+  {
+    memmove(input + seqoffset[r],ranges[r].sequence + dropsep[r],
+            (size_t) (ranges[r].totallength - dropsep[r]));
+  }
+#pragma omp parallel for schedule(dynamic,1)
+  for(r = 0; r < numofranges; r++)
+  {
+    Uint i;
+
+    for(i = dropsep[r]; i < ranges[r].markpos.nextfreeUint; i++)
+    {
+      multiseq->markpos.spaceUint[markoffset[r] + i - dropsep[r]]
+        = seqoffset[r] + ranges[r].markpos.spaceUint[i] - dropsep[r];
+    }
+    for(i = 0; i < ranges[r].numofsequences; i++)
+    {
+      multiseq->startdesc[recordoffset[r] + i] 
+        = descoffset[r] + ranges[r].startdesc[i];
+    }
+    if(ranges[r].descspace.nextfreeUchar > 0)
+    {
+      memcpy(multiseq->descspace.spaceUchar + descoffset[r],
+             ranges[r].descspace.spaceUchar,
+             (size_t) ranges[r].descspace.nextfreeUchar);
+    }
+    FREEARRAY(&ranges[r].markpos,Uint);
+    FREEARRAY(&ranges[r].descspace,Uchar);
+    FREESPACE(ranges[r].startdesc);
+  }
+  FREESPACE(seqoffset);
+  FREESPACE(markoffset);
+  FREESPACE(descoffset);
+  FREESPACE(recordoffset);
+  FREESPACE(dropsep);
+}
+
+static void scanfastainput (Multiseq *multiseq,
+                            char *filename,
+                            Uchar replacewildcardchar,
+                            Uchar *input,
+                            Uint inputlen)
+{
+  Uint r, numofranges = 1;
+  Uchar **rangestart;
+  Multiseq *ranges;
+
+#ifdef __SSSE3__
+  initcompactindex();
+#endif
+  if(inputlen >= MINPARALLELINPUT)
+  {
+    numofranges = (Uint) omp_get_max_threads();
+  }
+  if(numofranges <= UintConst(1))
+  {
+    scanfastarange(multiseq,filename,replacewildcardchar,input,inputlen,
+                   false);
+  } else
+  {
+    rangestart = ALLOCSPACE(NULL,Uchar *,numofranges+1);
+    ranges = ALLOCSPACE(NULL,Multiseq,numofranges);
+    rangestart[0] = input;
+    rangestart[numofranges] = input + inputlen;
+    for(r = UintConst(1); r < numofranges; r++)
+    {
+      rangestart[r] = nextrecordstart(MAX(rangestart[r-1],
+                                          input + r * (inputlen/numofranges)),
+                                      input + inputlen);
+    }
+#pragma omp parallel for schedule(dynamic,1)
+    for(r = 0; r < numofranges; r++)
+    {
+      scanfastarange(ranges + r,filename,replacewildcardchar,rangestart[r],
+                     (Uint) (rangestart[r+1] - rangestart[r]),r > 0);
+    }
+    stitchfastaranges(multiseq,input,ranges,numofranges);
+    FREESPACE(rangestart);
+    FREESPACE(ranges);
+  }
+  multiseq->originalsequence = NULL;
+}
+
 /*EE
   The following function scans a string containing the content of
   a multiple fasta formatted file. The parameter are as follows:
@@ -72,6 +485,10 @@
   the end of the input string) are scanned for alphanumeric
   characters which make up the sequence. White spaces are ignored.
   Upper case characters are transformed to lower case.
+  If SSSE3 is available, the sequence lines are transformed in blocks
+  of 16 characters, see \texttt{scansequenceblock}. An input of at
+  least \texttt{MINPARALLELINPUT} characters is split into ranges
+  which are scanned in parallel, see \texttt{stitchfastaranges}.
   The input string must contain at least one sequence.
   In case of a error, an negative error code is returned.
   In case of success, the return code is 0.
@@ -83,130 +500,205 @@ Sint scanmultiplefastafile (Multiseq *multiseq,
                             Uchar *input,
                             Uint inputlen)
 {
-  Uchar *inputptr,      // points to a suffix of the input
-        *newptr,        // points to the transform,ed
-        tmpchar;        // temporary character
-  Uint allocatedstartdesc = 0;  // num of characters allocated for startdesc
-  bool indesc = false,          // inside description part of sequence
-       copydescription = false; // currently copying the description 
-
 //fprintf(stderr,"# reading input file \"%s\" ",filename);
-  initmultiseq (multiseq);
-  multiseq->originalsequence = NULL;
+  scanfastainput(multiseq,filename,replacewildcardchar,input,inputlen);
+  if (multiseq->numofsequences == 0)
+  {
+    cerr << "no sequences in multiple fasta file" << endl;
+    return -2;
+  }
+  if(multiseq->totallength == 0)
+  {
+    cerr << "empty sequence in multiple fasta file" << endl;
+    return -3;
+  }
+  //fprintf(stderr,"of length %lu\n",(long unsigned int) multiseq->totallength);
+  return 0;
+}
 
-  newptr = multiseq->sequence = input;
-  for (inputptr = input; inputptr < input + inputlen; inputptr++)
+/*
+  The query files are read in windows of \texttt{QUERYWINDOWSIZE} bytes.
+  The following function delivers the position of the last symbol 
+  \texttt{>} at the start of a line in the first \texttt{filled} bytes
+  of \texttt{buffer}, such that some record starts before it. The
+  records before this position are complete. If there is no such
+  position, then 0 is returned.
+*/
+
+#define QUERYWINDOWSIZE (UintConst(1) << 24)
+
+static Uint lastrecordstart(Uchar *buffer,Uint filled)
+{
+  Uchar *firstrecord, *ptr;
+
+  firstrecord = (Uchar *) memchr(buffer,FASTASEPARATOR,(size_t) filled);
+  if(firstrecord == NULL)
+  {
+    return 0;
+  }
+  for(ptr = buffer + filled - 1; ptr > firstrecord + 1; ptr--)
   {
-    if (indesc)
+    if(*ptr == FASTASEPARATOR && ptr[-1] == '\n')
     {
-      if(copydescription)
-      {
-        if(isspace((int) *inputptr))
-        {
-          copydescription = false;
-          STOREINARRAY (&multiseq->descspace, 
-                        Uchar,
-                        4096,
-                        (Uchar) '\n');
-        } else
-        {
-          STOREINARRAY (&multiseq->descspace, 
-                        Uchar,
-                        4096,
-                        *inputptr);
-        }
-      } 
-      if (*inputptr == '\n')
-      {
-        indesc = false;
-      }
+      return (Uint) (ptr - buffer);
     }
-    else
+  }
+  return 0;
+}
+
+/*
+  The following function frees the space for the positions and the
+  descriptions of the records of the current window. The sequence
+  is stored in the buffer of the window and therefore not freed.
+*/
+
+static void freequerywindow(Multiseq *multiseq)
+{
+  FREEARRAY(&multiseq->markpos,Uint);
+  FREEARRAY(&multiseq->descspace,Uchar);
+  FREESPACE(multiseq->startdesc);
+  multiseq->sequence = NULL;
+}
+
+/*
+  The following function reads up to \texttt{numofbytes} uncompressed
+  bytes from \texttt{fp} into \texttt{buffer}. Since \texttt{gzread} 
+  delivers at most \texttt{INT\_MAX} bytes per call, larger requests 
+  are split. It returns the number of bytes read, which is smaller than
+  \texttt{numofbytes} only at the end of the file or in case of an error.
+*/
+
+#define GZIPBUFFERSIZE (UintConst(1) << 18)
+#define GZIPREADCHUNK  (UintConst(1) << 30)
+
+static Uint readquerybytes(gzFile fp,Uchar *buffer,Uint numofbytes)
+{
+  Uint total = 0;
+  int readbytes;
+
+  while(total < numofbytes)
+  {
+    readbytes = gzread(fp,buffer + total,
+                       (unsigned int) MIN(numofbytes - total,GZIPREADCHUNK));
+    if(readbytes <= 0)
     {
-      if (*inputptr == FASTASEPARATOR)
-      {
-        STORESTARTDESC;
-        if (multiseq->numofsequences > 0)
-        {
-          STOREINARRAY (&multiseq->markpos, 
-                        Uint,
-                        128,
-                        (Uint) (newptr - multiseq->sequence));
+      break;
+    }
+    total += (Uint) readbytes;
+  }
+  return total;
+}
 
-          *newptr++ = SEPARATOR;
-        }
-        multiseq->numofsequences++;
-        indesc = true;
-        copydescription = true;
-      }
-      else
+/*EE
+  The following function reads the multiple fasta file \texttt{filename},
+  or the standard input if \texttt{filename} is \texttt{-}, and applies
+  \texttt{apply} to all sequences in it like \texttt{overallsequences}.
+  The file is read via \texttt{zlib}, so that it may be compressed by
+  \texttt{gzip} or \texttt{bgzip}, which is decompressed as a stream.
+  The file is not mapped as a whole. Instead, the bytes are read into a
+  buffer of \texttt{QUERYWINDOWSIZE} bytes, which is cut before the last
+  line beginning with the symbol \texttt{>}. The records before the cut
+  are scanned into \texttt{multiseq} by \texttt{scanfastainput} and 
+  processed, and then the remaining bytes are moved to the start of
+  the buffer. If the buffer contains no complete record, its size is 
+  doubled. Hence the space required is bounded by the size of the window
+  or of the longest record, whichever is larger. The sequence numbers
+  passed to \texttt{apply} refer to the records of the current window 
+  in \texttt{multiseq}. In case of a error, an negative error code is 
+  returned. In case of success, the return code is 0.
+*/
+
+Sint overallqueryrecords(Multiseq *multiseq,
+                         char *filename,
+                         Uchar replacewildcardchar,
+                         void *applyinfo,
+                         Sint(*apply)(void *,Uint,Uchar *,Uint))
+{
+  gzFile fp;
+  Uchar *buffer;
+  Uint buffersize = QUERYWINDOWSIZE, filled = 0, cut, readbytes,
+       totalbytes = 0, numofsequences = 0, totallength = 0;
+  bool endoffile = false;
+  int errnum;
+
+  if(strcmp(filename,"-") == 0)
+  {
+    fp = gzdopen(fileno(stdin),"rb");
+  } else
+  {
+    fp = gzopen(filename,"rb");
+  }
+  if(fp == NULL)
+  {
+    fprintf(stderr,"cannot open file \"%s\"\n",filename);
+    return -1;
+  }
+  (void) gzbuffer(fp,(unsigned int) GZIPBUFFERSIZE);
+  buffer = ALLOCSPACE(NULL,Uchar,buffersize);
+  while(true)
+  {
+    if(!endoffile)
+    {
+      readbytes = readquerybytes(fp,buffer + filled,buffersize - filled);
+      if(readbytes < buffersize - filled)
       {
-        tmpchar = *inputptr;
-        if (!isspace ((int) tmpchar))
+        if(gzerror(fp,&errnum) != NULL && errnum != Z_OK && 
+           errnum != Z_STREAM_END)
         {
-          tmpchar = (Uchar) tolower ((int) tmpchar);
-          if (replacewildcardchar != 0)  // replace wildcards
-          {
-            switch (tmpchar)
-            {
-              case 'a':
-              case 'c':
-              case 'g':
-              case 't':
-                break;
-              default:
-                   fprintf(stderr,"filename %s: replace '%c' by '%c'\n",
-                   filename,tmpchar,replacewildcardchar);
-                tmpchar = replacewildcardchar;
-            }
-          }
-#ifdef WARNINGIFNONUCLEOTIDES
-          else
-          {
-            switch (tmpchar)
-            {
-              case 'a':
-              case 'c':
-              case 'g':
-              case 't':
-              case 's':
-              case 'w':
-              case 'r':
-              case 'y':
-              case 'm':
-              case 'k':
-              case 'b':
-              case 'd':
-              case 'h':
-              case 'v':
-              case 'n':
-                break;
-              default:
-                fprintf (stderr,
-                         "Unexpected character '%c\' in string %s\n",
-                         tmpchar, filename);
-                tmpchar = 'n';
-            }
-          }
-#endif
-          *newptr++ = tmpchar;
+          fprintf(stderr,"cannot read file \"%s\": %s\n",filename,
+                  gzerror(fp,&errnum));
+          (void) gzclose(fp);
+          FREESPACE(buffer);
+          return -1;
         }
+        endoffile = true;
       }
+      filled += readbytes;
+      totalbytes += readbytes;
+    }
+    if(filled == 0)
+    {
+      break;
+    }
+    cut = endoffile ? filled : lastrecordstart(buffer,filled);
+    if(cut == 0)
+    {
+      buffersize *= 2;
+      buffer = ALLOCSPACE(buffer,Uchar,buffersize);
+      continue;
+    }
+    scanfastainput(multiseq,filename,replacewildcardchar,buffer,cut);
+    numofsequences += multiseq->numofsequences;
+    totallength += multiseq->totallength;
+    if(multiseq->numofsequences > 0 &&
+       overallsequences(false,multiseq,applyinfo,apply) != 0)
+    {
+      freequerywindow(multiseq);
+      FREESPACE(buffer);
+      (void) gzclose(fp);
+      return -4;
     }
+    freequerywindow(multiseq);
+    memmove(buffer,buffer + cut,(size_t) (filled - cut));
+    filled -= cut;
   }
-  STORESTARTDESC;
-  if (multiseq->numofsequences == 0)
+  FREESPACE(buffer);
+  (void) gzclose(fp);
+  if(totalbytes == 0)
+  {
+    fprintf(stderr,"file \"%s\" is empty\n",filename);
+    return -1;
+  }
+  if(numofsequences == 0)
   {
     cerr << "no sequences in multiple fasta file" << endl;
     return -2;
   }
-  multiseq->totallength = (Uint) (newptr - multiseq->sequence);
-  if(multiseq->totallength == 0)
+  if(totallength == 0)
   {
     cerr << "empty sequence in multiple fasta file" << endl;
     return -3;
   }
-  //fprintf(stderr,"of length %lu\n",(long unsigned int) multiseq->totallength);
   return 0;
 }
 
@@ -214,6 +706,8 @@ Sint scanmultiplefastafile (Multiseq *multiseq,
   The following function reads the subject and queryfile and
   delivers the parsed multiple sequences in the corresponding
   \texttt{Multiseq}-records. The files are read via memory mapping.
+  A subject file compressed by \texttt{gzip} or \texttt{bgzip} is
+  decompressed by \texttt{inflatefilecontent} before it is scanned.
   The subject file must contain exactly one sequence.
   Both files cannot be empty. The parameter \texttt{matchnucleotidesonly}
   is true iff if the programm was called with option \texttt{-n},
@@ -225,7 +719,7 @@ Sint scanmultiplefastafile (Multiseq *multiseq,
 Sint getmaxmatinput (Multiseq *subjectmultiseq, bool matchnucleotidesonly, char *subjectfile)
 {
   Uint filelen;
-  Uchar *filecontent;
+  Uchar *filecontent, *compressed;
 
   filecontent = (Uchar *)CREATEMEMORYMAP (subjectfile, true, &filelen);
   if (filecontent == NULL || filelen == 0)
@@ -233,6 +727,17 @@ Sint getmaxmatinput (Multiseq *subjectmultiseq, bool matchnucleotidesonly, char
     fprintf(stderr, "cannot open file \"%s\" or file \"%s\" is empty",subjectfile, subjectfile);
     return -1;
   }
+  if (gzipcompressed (filecontent, filelen))
+  {
+    compressed = filecontent;
+    filecontent = inflatefilecontent (subjectfile, compressed, filelen,
+                                      &filelen);
+    (void) DELETEMEMORYMAP (compressed);
+    if (filecontent == NULL)
+    {
+      return -1;
+    }
+  }
   if (scanmultiplefastafile (subjectmultiseq, subjectfile,
                              matchnucleotidesonly ? MMREPLACEMENTCHARSUBJECT
                                                   : 0,
@@ -243,3 +748,41 @@ Sint getmaxmatinput (Multiseq *subjectmultiseq, bool matchnucleotidesonly, char
   }
   return 0;
 }
+
+/*EE
+  The following function reads the \texttt{numofshards} files of 
+  \texttt{shardfilelist} by \texttt{getmaxmatinput} and concatenates
+  them to the subject-sequence in \texttt{subjectmultiseq}, such that
+  each shard is separated from the next by the symbol 
+  \texttt{SEPARATOR}. \texttt{shardstart} must provide space for
+  \texttt{numofshards}\(+1\) values. \texttt{shardstart[i]} is set to 
+  the start of shard \(i\) in the subject-sequence, and 
+  \texttt{shardstart[numofshards]} to the total length plus 1.
+  If a shard cannot be read, then the shards already read are freed.
+*/
+
+Sint getshardedmaxmatinput (Multiseq *subjectmultiseq, Uint *shardstart,
+                            bool matchnucleotidesonly, char **shardfilelist,
+                            Uint numofshards)
+{
+  Uint shard, i;
+  Multiseq *shards;
+
+  shards = ALLOCSPACE(NULL,Multiseq,numofshards);
+  for(shard = 0; shard < numofshards; shard++)
+  {
+    if(getmaxmatinput(shards + shard,matchnucleotidesonly,
+                      shardfilelist[shard]) != 0)
+    {
+      for(i = 0; i < shard; i++)
+      {
+        freemultiseq(shards + i);
+      }
+      FREESPACE(shards);
+      return -1;
+    }
+  }
+  concatmultiseqs(subjectmultiseq,shards,numofshards,shardstart);
+  FREESPACE(shards);
+  return 0;
+}
@@ -10,11 +10,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include "types.h"
 #include "optdesc.h"
 #include "errordef.h"
+#include "spacedef.h"
 #include "protodef.h"
 #include "maxmatdef.h"
+#include "minmax.h"
 
 //}
 
@@ -37,6 +41,19 @@
  */
 
 #define DEFAULTCHUNK 2
+
+/*
+ * The default length of the prefixes in the Direct Access Table
+ */
+
+#define DEFAULTPREFIXLENGTH 8
+
+/*
+ * The maximal length of the prefixes in the Direct Access Table, whose
+ * offsets take 4^prefix entries regardless of the length of the subject
+ */
+
+#define MAXPREFIXLENGTH 12
 //}
 
 /*EE
@@ -59,6 +76,20 @@ typedef enum
   OPTSHOWSEQUENCELENGTHS,
   OPTCHUNKS,
   OPTPREFIXLENGTH,
+  OPTHYBRID,
+  OPTBUCKETCAP,
+  OPTBATCHJOIN,
+  OPTCACHEBLOCK,
+  OPTMINIMIZER,
+  OPTSPARSE,
+  OPTPACKED,
+  OPTRCINDEX,
+  OPTSHARDS,
+  OPTLEAFCOUNTS,
+  OPTHUGEPAGES,
+  OPTNUMA,
+  OPTMANIFEST,
+  OPTVERBOSE,
   OPTH,
   OPTHELP,
   NUMOFOPTIONS
@@ -88,11 +119,108 @@ static void showusage(char *program,OptionDescription *options,
   printf("Usage: %s [options] <reference-file> <query-files>\n\n"
          "Find and output (to stdout) the positions and length of all\n"
          "sufficiently long maximal matches of a substring in\n"
-         "<query-file> and <reference-file>\n\n",program);
+         "<query-file> and <reference-file>. A <query-file> given as -\n"
+         "is read from stdin\n\n",program);
   printf("Options:\n");
   showoptions(stdout,program,options,numofoptions);
 }
 
+/*
+  The lists of query files and of shard files are not bounded. The
+  following function appends the first \texttt{len} characters of
+  \texttt{filename} to the list \texttt{*filelist} of 
+  \texttt{*numoffiles} names, which is enlarged by 128 entries whenever 
+  all \texttt{*allocatedfiles} entries are used.
+*/
+
+static void addfilename(char ***filelist,Uint *numoffiles,
+                        Uint *allocatedfiles,char *filename,Uint len)
+{
+  char *copy;
+
+  if(*numoffiles >= *allocatedfiles)
+  {
+    *allocatedfiles += 128;
+    *filelist = ALLOCSPACE(*filelist,char *,*allocatedfiles);
+  }
+  copy = ALLOCSPACE(NULL,char,len+1);
+  memcpy(copy,filename,(size_t) len);
+  copy[len] = '\0';
+  (*filelist)[(*numoffiles)++] = copy;
+}
+
+/*
+  The following function appends the files listed in \texttt{listfile}
+  to the list \texttt{*filelist}. Each line contains one filename. 
+  White space at the end of a line is removed, and empty lines and 
+  lines beginning with \texttt{\#} are skipped.
+*/
+
+static Sint readfilelist(char *listfile,char ***filelist,Uint *numoffiles,
+                         Uint *allocatedfiles)
+{
+  Uint filelen;
+  char *filecontent, *linestart, *lineend, *fileend;
+
+  filecontent = (char *) CREATEMEMORYMAP(listfile,false,&filelen);
+  if(filecontent == NULL)
+  {
+    ERROR1("cannot read file list %s",listfile);
+    return -1;
+  }
+  fileend = filecontent + filelen;
+  for(linestart = filecontent; linestart < fileend; linestart = lineend + 1)
+  {
+    lineend = (char *) memchr(linestart,'\n',(size_t) (fileend - linestart));
+    if(lineend == NULL)
+    {
+      lineend = fileend;
+    }
+    while(lineend > linestart && isspace((int) lineend[-1]))
+    {
+      lineend--;
+    }
+    if(lineend > linestart && *linestart != '#')
+    {
+      addfilename(filelist,numoffiles,allocatedfiles,linestart,
+                  (Uint) (lineend - linestart));
+    }
+    lineend = (char *) memchr(lineend,'\n',(size_t) (fileend - lineend));
+    if(lineend == NULL)
+    {
+      break;
+    }
+  }
+  if(DELETEMEMORYMAP(filecontent) != 0)
+  {
+    return -2;
+  }
+  return 0;
+}
+
+/*EE
+  The following function frees the list of query files and the list
+  of shard files.
+*/
+
+void freequeryfilelist(MMcallinfo *mmcallinfo)
+{
+  Uint filenum;
+
+  for(filenum = 0; filenum < mmcallinfo->numofqueryfiles; filenum++)
+  {
+    FREESPACE(mmcallinfo->queryfilelist[filenum]);
+  }
+  FREESPACE(mmcallinfo->queryfilelist);
+  mmcallinfo->numofqueryfiles = mmcallinfo->allocatedqueryfiles = 0;
+  for(filenum = 0; filenum < mmcallinfo->numofshards; filenum++)
+  {
+    FREESPACE(mmcallinfo->shardfilelist[filenum]);
+  }
+  FREESPACE(mmcallinfo->shardfilelist);
+  mmcallinfo->numofshards = mmcallinfo->allocatedshards = 0;
+}
+
 /*EE 
   The following function declares the possible options
   in a record \texttt{options}. It then ananlyzes the \texttt{argv}-vector
@@ -139,12 +267,65 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
   ADDOPTION(OPTSHOWSEQUENCELENGTHS,"-L",
             "show the length of the query sequences on the header line");
   ADDOPTION(OPTCHUNKS,"-C","number of chunks to split query sequence");
-  ADDOPTION(OPTPREFIXLENGTH,"-P","length of prefix for Direct Access Table");
+  ADDOPTION(OPTPREFIXLENGTH,"-P","length of prefix for Direct Access Table\n"
+            "at most 12 and at most the minimum length of a match;\n"
+            "default is 8 or the minimum length of a match, if shorter");
+  ADDOPTION(OPTHYBRID,"-hybrid",
+            "with -maxmatch, verify the suffixes of buckets with at most\n"
+            "the given number of suffixes directly, and use the suffix\n"
+            "tree for query regions hitting larger buckets");
+  ADDOPTION(OPTBUCKETCAP,"-bucketcap",
+            "defer the verification of query positions hitting buckets\n"
+            "with more than the given number of suffixes to a batched\n"
+            "pass after the scan of the query");
+  ADDOPTION(OPTBATCHJOIN,"-batch",
+            "probe the table for blocks of query positions sorted by\n"
+            "their prefix codes instead of in the order of the query");
+  ADDOPTION(OPTCACHEBLOCK,"-cacheblock",
+            "probe the table for blocks of query positions partitioned\n"
+            "into bins whose part of the table fits into the L2 cache");
+  ADDOPTION(OPTMINIMIZER,"-w",
+            "with -maxmatch, index only the minimizers of the windows of\n"
+            "the given number of consecutive prefixes of the subject-sequence\n"
+            "instead of building the suffix tree");
+  ADDOPTION(OPTSPARSE,"-sparse",
+            "with -maxmatch, index only the suffixes of the subject-sequence\n"
+            "starting at the multiples of the given step instead of\n"
+            "building the suffix tree, and probe every query suffix");
+  ADDOPTION(OPTPACKED,"-packed",
+            "with -w or -sparse, store the subject-sequence with 2 bits\n"
+            "per base and the other characters in a table of runs");
+  ADDOPTION(OPTRCINDEX,"-rcindex",
+            "with -maxmatch and -b or -r, index the reverse complement of\n"
+            "the subject-sequence behind it and find the matches on both\n"
+            "strands by one scan of the unmodified query");
+  ADDOPTION(OPTSHARDS,"-shards",
+            "with -w or -sparse, the reference-file lists the files of the\n"
+            "reference shards, one per line; the sampled suffixes of a\n"
+            "shard are cached with their codes in the file with suffix\n"
+            ".shard and only computed again if the shard or the\n"
+            "parameters have changed");
+  ADDOPTION(OPTLEAFCOUNTS,"-leafcounts",
+            "compute the MUM-candidates by scanning the suffix tree, where\n"
+            "the number of leaves below each branching node, computed in\n"
+            "parallel, decides the uniqueness of a match");
+  ADDOPTION(OPTHUGEPAGES,"-hugepages",
+            "back the suffix tree and the sequences by 2 MB huge pages");
+  ADDOPTION(OPTNUMA,"-numa",
+            "place the suffix tree and the sequences on the NUMA nodes:\n"
+            "local, interleave, or replicate (read-only copy per node)");
+  ADDOPTION(OPTMANIFEST,"-manifest",
+            "read the names of further query files from the given file,\n"
+            "one per line; empty lines and lines starting with # are\n"
+            "skipped");
+  ADDOPTION(OPTVERBOSE,"-verbose",
+            "show statistics about the table and the probes on stderr");
   ADDOPTION(OPTH,"-h",
 	    "show possible options");
   ADDOPTION(OPTHELP,"-help",
             "show possible options");
   mmcallinfo->showstring = false;
+  mmcallinfo->verbose = false;
   mmcallinfo->reversecomplement = false;
   mmcallinfo->forward = true;
   mmcallinfo->showreversepositions = false;
@@ -156,6 +337,28 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
   mmcallinfo->cmaxmatch = false;
   mmcallinfo->minmatchlength = (Uint) DEFAULTMINUNIQUEMATCHLEN;
   mmcallinfo->chunks = (Uint) DEFAULTCHUNK;
+  mmcallinfo->probeoptions.hybridthreshold = 0;
+  mmcallinfo->probeoptions.bucketcap = 0;
+  mmcallinfo->probeoptions.batchjoin = false;
+  mmcallinfo->probeoptions.cacheblocked = false;
+  mmcallinfo->probeoptions.minimizerwindow = 0;
+  mmcallinfo->probeoptions.sparsestep = 0;
+  mmcallinfo->probeoptions.leafcounts = false;
+  mmcallinfo->probeoptions.packedtext = NULL;
+  mmcallinfo->prefix = (Uint) DEFAULTPREFIXLENGTH;
+  mmcallinfo->hugepages = false;
+  mmcallinfo->packsubject = false;
+  mmcallinfo->rcindex = false;
+  mmcallinfo->shards = false;
+  mmcallinfo->numapolicy = NUMANONE;
+  mmcallinfo->manifestfile[0] = '\0';
+  mmcallinfo->numofqueryfiles = 0;
+  mmcallinfo->allocatedqueryfiles = 0;
+  mmcallinfo->queryfilelist = NULL;
+  mmcallinfo->numofshards = 0;
+  mmcallinfo->allocatedshards = 0;
+  mmcallinfo->shardfilelist = NULL;
+  mmcallinfo->shardstart = NULL;
 
   if(argc == 1)
   {
@@ -251,15 +454,155 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
                   argv[argnum],options[OPTPREFIXLENGTH].optname);
           return -3;
         }
+        if(readint > (signed long) MAXPREFIXLENGTH)
+        {
+          ERROR3("argument %s for option %s must not exceed %lu",
+                  argv[argnum],options[OPTPREFIXLENGTH].optname,
+                  (long unsigned int) MAXPREFIXLENGTH);
+          return -3;
+        }
         mmcallinfo->prefix = (Uint) readint;
         break;
+      case OPTHYBRID:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTHYBRID].optname);
+          return -2;
+        }
+        if(sscanf(argv[argnum],"%ld",&readint) != 1 || readint <= 0)
+        {
+          ERROR2("argument %s for option %s is not a positive integer",
+                  argv[argnum],options[OPTHYBRID].optname);
+          return -3;
+        }
+        mmcallinfo->probeoptions.hybridthreshold = (Uint) readint;
+        break;
+      case OPTBUCKETCAP:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTBUCKETCAP].optname);
+          return -2;
+        }
+        if(sscanf(argv[argnum],"%ld",&readint) != 1 || readint <= 0)
+        {
+          ERROR2("argument %s for option %s is not a positive integer",
+                  argv[argnum],options[OPTBUCKETCAP].optname);
+          return -3;
+        }
+        mmcallinfo->probeoptions.bucketcap = (Uint) readint;
+        break;
+      case OPTBATCHJOIN:
+        mmcallinfo->probeoptions.batchjoin = true;
+        break;
+      case OPTCACHEBLOCK:
+        mmcallinfo->probeoptions.cacheblocked = true;
+        break;
+      case OPTMINIMIZER:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTMINIMIZER].optname);
+          return -2;
+        }
+        if(sscanf(argv[argnum],"%ld",&readint) != 1 || readint <= 0)
+        {
+          ERROR2("argument %s for option %s is not a positive integer",
+                  argv[argnum],options[OPTMINIMIZER].optname);
+          return -3;
+        }
+        mmcallinfo->probeoptions.minimizerwindow = (Uint) readint;
+        break;
+      case OPTSPARSE:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTSPARSE].optname);
+          return -2;
+        }
+        if(sscanf(argv[argnum],"%ld",&readint) != 1 || readint <= 0)
+        {
+          ERROR2("argument %s for option %s is not a positive integer",
+                  argv[argnum],options[OPTSPARSE].optname);
+          return -3;
+        }
+        mmcallinfo->probeoptions.sparsestep = (Uint) readint;
+        break;
+      case OPTPACKED:
+        mmcallinfo->packsubject = true;
+        break;
+      case OPTRCINDEX:
+        mmcallinfo->rcindex = true;
+        break;
+      case OPTSHARDS:
+        mmcallinfo->shards = true;
+        break;
+      case OPTLEAFCOUNTS:
+        mmcallinfo->probeoptions.leafcounts = true;
+        break;
+      case OPTHUGEPAGES:
+        mmcallinfo->hugepages = true;
+        break;
+      case OPTNUMA:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTNUMA].optname);
+          return -2;
+        }
+        if(strcmp(argv[argnum],"local") == 0)
+        {
+          mmcallinfo->numapolicy = NUMALOCAL;
+        } else
+        {
+          if(strcmp(argv[argnum],"interleave") == 0)
+          {
+            mmcallinfo->numapolicy = NUMAINTERLEAVE;
+          } else
+          {
+            if(strcmp(argv[argnum],"replicate") == 0)
+            {
+              mmcallinfo->numapolicy = NUMAREPLICATE;
+            } else
+            {
+              ERROR2("argument %s for option %s must be local, interleave, "
+                     "or replicate",argv[argnum],options[OPTNUMA].optname);
+              return -3;
+            }
+          }
+        }
+        break;
+      case OPTMANIFEST:
+        argnum++;
+        if(argnum > (Uint) (argc-2))
+        {
+          ERROR1("missing argument for option %s",
+                  options[OPTMANIFEST].optname);
+          return -2;
+        }
+        if(safestringcopy(&mmcallinfo->manifestfile[0],argv[argnum],
+                          PATH_MAX) != 0)
+        {
+          return -3;
+        }
+        break;
+      case OPTVERBOSE:
+        mmcallinfo->verbose = true;
+        break;
       case OPTH:
       case OPTHELP:
         showusage(argv[0],&options[0],(Uint) NUMOFOPTIONS);
         return 1;
     }
   }
-  if(argnum > (Uint) (argc-2))
+  if(argnum > (Uint) (argc-2) && 
+     (mmcallinfo->manifestfile[0] == '\0' || argnum > (Uint) (argc-1)))
   {
     ERROR0("missing file arguments");
     return -4;
@@ -272,22 +615,42 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
   {
     return -6;
   }
-  for(argnum++, mmcallinfo->numofqueryfiles = 0; 
-      argnum < (Uint) argc; mmcallinfo->numofqueryfiles++, argnum++)
+  for(argnum++; argnum < (Uint) argc; argnum++)
   {
-    if(mmcallinfo->numofqueryfiles >= (Uint) MAXNUMOFQUERYFILES)
+    addfilename(&mmcallinfo->queryfilelist,&mmcallinfo->numofqueryfiles,
+                &mmcallinfo->allocatedqueryfiles,argv[argnum],
+                (Uint) strlen(argv[argnum]));
+  }
+  if(mmcallinfo->manifestfile[0] != '\0')
+  {
+    if(readfilelist(&mmcallinfo->manifestfile[0],&mmcallinfo->queryfilelist,
+                    &mmcallinfo->numofqueryfiles,
+                    &mmcallinfo->allocatedqueryfiles) != 0)
     {
-      ERROR1("too many query files, maximal number is %d",
-              (int) MAXNUMOFQUERYFILES);
       return -7;
     }
-    if(safestringcopy(&mmcallinfo->queryfilelist
-                       [mmcallinfo->numofqueryfiles][0],
-                      argv[argnum],PATH_MAX) != 0)
+    if(mmcallinfo->numofqueryfiles == 0)
     {
+      ERROR1("manifest %s does not contain any query file",
+             &mmcallinfo->manifestfile[0]);
       return -8;
     }
   }
+  if(mmcallinfo->shards)
+  {
+    if(readfilelist(&mmcallinfo->subjectfile[0],&mmcallinfo->shardfilelist,
+                    &mmcallinfo->numofshards,
+                    &mmcallinfo->allocatedshards) != 0)
+    {
+      return -11;
+    }
+    if(mmcallinfo->numofshards == 0)
+    {
+      ERROR1("file list %s does not contain any shard file",
+             &mmcallinfo->subjectfile[0]);
+      return -12;
+    }
+  }
   /*
     verify that mum options are not interchanged
   */
@@ -296,6 +659,59 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
   OPTIONEXCLUDE(OPTMUM,OPTMAXMATCH);
   OPTIONEXCLUDE(OPTMUMCAND,OPTMAXMATCH);
   OPTIONEXCLUDE(OPTMUMREF,OPTMAXMATCH);
+  OPTIONIMPLY(OPTHYBRID,OPTMAXMATCH);
+  OPTIONIMPLY(OPTMINIMIZER,OPTMAXMATCH);
+  OPTIONEXCLUDE(OPTMINIMIZER,OPTHYBRID);
+  OPTIONIMPLY(OPTSPARSE,OPTMAXMATCH);
+  OPTIONEXCLUDE(OPTSPARSE,OPTHYBRID);
+  OPTIONEXCLUDE(OPTSPARSE,OPTMINIMIZER);
+  OPTIONIMPLYEITHER2(OPTPACKED,OPTMINIMIZER,OPTSPARSE);
+  OPTIONIMPLY(OPTRCINDEX,OPTMAXMATCH);
+  OPTIONEXCLUDE(OPTRCINDEX,OPTPACKED);
+  OPTIONIMPLYEITHER2(OPTSHARDS,OPTMINIMIZER,OPTSPARSE);
+  OPTIONEXCLUDE(OPTSHARDS,OPTRCINDEX);
+  OPTIONEXCLUDE(OPTLEAFCOUNTS,OPTMAXMATCH);
+  /*
+    a match of length minmatchlength must contain a whole prefix, since 
+    otherwise its code is not in the table; so the default is shortened
+    accordingly, while an explicit argument of option -P is rejected
+  */
+  if(!ISSET(OPTPREFIXLENGTH))
+  {
+    mmcallinfo->prefix = MIN((Uint) DEFAULTPREFIXLENGTH,
+                             mmcallinfo->minmatchlength);
+  } else if(mmcallinfo->prefix > mmcallinfo->minmatchlength)
+  {
+    ERROR2("argument %lu for option %s must not exceed the minimum match "
+           "length",(long unsigned int) mmcallinfo->prefix,
+           options[OPTPREFIXLENGTH].optname);
+    return -13;
+  }
+  /*
+    a match of length minmatchlength must contain a whole window of
+    prefixes, since otherwise it may not contain a minimizer, and it
+    must contain a whole prefix starting at a multiple of the sparse step
+  */
+  if(mmcallinfo->probeoptions.minimizerwindow > 0 &&
+     mmcallinfo->minmatchlength + 1 < 
+     mmcallinfo->probeoptions.minimizerwindow + mmcallinfo->prefix)
+  {
+    ERROR2("option %s requires a minimum match length of at least %lu",
+           options[OPTMINIMIZER].optname,
+           (long unsigned int) (mmcallinfo->probeoptions.minimizerwindow + 
+                                mmcallinfo->prefix - 1));
+    return -9;
+  }
+  if(mmcallinfo->probeoptions.sparsestep > 0 &&
+     mmcallinfo->minmatchlength + 1 < 
+     mmcallinfo->probeoptions.sparsestep + mmcallinfo->prefix)
+  {
+    ERROR2("option %s requires a minimum match length of at least %lu",
+           options[OPTSPARSE].optname,
+           (long unsigned int) (mmcallinfo->probeoptions.sparsestep + 
+                                mmcallinfo->prefix - 1));
+    return -10;
+  }
   if ( mmcallinfo->cmaxmatch )
     {
       mmcallinfo->cmum = false;
@@ -318,5 +734,10 @@ Sint parsemaxmatoptions(MMcallinfo *mmcallinfo,int argc, char *argv[])
   */
   OPTIONIMPLYEITHER2(OPTSHOWREVERSEPOSITIONS,
                      OPTCOMPUTEBOTHDIRECTIONS,OPTONLYREVERSECOMPLEMENT);
+  /*
+    verify that -rcindex is only used in combination with either -b or -r
+  */
+  OPTIONIMPLYEITHER2(OPTRCINDEX,
+                     OPTCOMPUTEBOTHDIRECTIONS,OPTONLYREVERSECOMPLEMENT);
   return 0;
 }
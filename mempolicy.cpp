@@ -0,0 +1,310 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mempolicy.cpp
+ *
+ *    Description:  Huge pages and NUMA placement for large index arrays
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 10:12:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+//\Ignore{
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <omp.h>
+#include "types.h"
+#include "protodef.h"
+#include "mempolicydef.h"
+
+//}
+
+/*EE
+  This file implements the placement policy for large memory blocks,
+  i.e.\ the suffix tree tables, the mapped sequence files and the
+  tables derived from them. The policy is set once from the command line
+  via \texttt{setmempolicy}. The function \texttt{applymempolicy} is
+  called by \texttt{allocandusespaceviaptr}, \texttt{reservespaceviaptr}
+  and \texttt{creatememorymapforfiledesc} for every block of at least
+  \texttt{HUGEPAGESIZE} bytes. It advises the kernel to back the block
+  by transparent huge pages and binds it to the NUMA nodes. The NUMA
+  system calls are issued directly, so that no additional library is
+  required. On a machine with a single node the NUMA policies have no
+  effect.
+*/
+
+/*
+  The policy and the number of NUMA nodes of the machine.
+*/
+
+static bool usehugepages = false;
+static Numapolicy numapolicy = NUMANONE;
+static Uint numofnumanodes = 0;
+
+/*
+  A read-only block replicated on every NUMA node.
+*/
+
+typedef struct
+{
+  void *original,                // the block the copies are made from
+       *copy[MAXNUMANODES];      // copy for each node, or \texttt{NULL}
+  Uint numofbytes;               // the size of the block
+} Replicatedblock;
+
+static Replicatedblock replicated[MAXREPLICATEDBLOCKS];
+static Uint numofreplicated = 0;
+
+/*
+  The following function determines the number of NUMA nodes
+  from the entries \texttt{node}\(i\) of the sysfs directory. If it
+  cannot be read, one node is assumed.
+*/
+
+static Uint countnumanodes(void)
+{
+  DIR *dir;
+  struct dirent *entry;
+  Uint nodenum, maxnode = 0;
+
+  if((dir = opendir("/sys/devices/system/node")) == NULL)
+  {
+    return UintConst(1);
+  }
+  while((entry = readdir(dir)) != NULL)
+  {
+    if(strncmp(entry->d_name,"node",(size_t) 4) == 0 &&
+       sscanf(entry->d_name+4,"%lu",&nodenum) == 1 &&
+       nodenum + 1 > maxnode)
+    {
+      maxnode = nodenum + 1;
+    }
+  }
+  (void) closedir(dir);
+  if(maxnode == 0)
+  {
+    return UintConst(1);
+  }
+  return (maxnode > (Uint) MAXNUMANODES) ? (Uint) MAXNUMANODES : maxnode;
+}
+
+/*
+  The following function restricts the block of \texttt{len} bytes
+  starting at \texttt{ptr} to the pages completely contained in it.
+  It returns false if there is no such page.
+*/
+
+static bool pagealign(void *ptr,Uint len,char **start,Uint *alignedlen)
+{
+  Uint pagesize = (Uint) sysconf(_SC_PAGESIZE),
+       first = ((Uint) ptr + pagesize - 1) & ~(pagesize - 1),
+       last = ((Uint) ptr + len) & ~(pagesize - 1);
+
+  if(last <= first)
+  {
+    return false;
+  }
+  *start = (char *) first;
+  *alignedlen = last - first;
+  return true;
+}
+
+/*
+  The following function binds the given range to the nodes in
+  \texttt{nodemask} according to \texttt{mode}. Pages of the range which
+  are already in use are moved to these nodes. Failures are ignored,
+  since the placement is only a hint.
+*/
+
+static void bindrange(char *start,Uint len,int mode,unsigned long nodemask)
+{
+  (void) syscall(SYS_mbind,start,(unsigned long) len,mode,
+                 (mode == MPOL_LOCAL) ? NULL : &nodemask,
+                 (unsigned long) (MAXNUMANODES+1),(unsigned) MPOL_MF_MOVE);
+}
+
+/*EE
+  The following function sets the policy applied to all large
+  memory blocks allocated afterwards.
+*/
+
+void setmempolicy(bool hugepages,Numapolicy policy)
+{
+  usehugepages = hugepages;
+  numapolicy = policy;
+  numofnumanodes = countnumanodes();
+}
+
+/*EE
+  The following function applies the current policy to the block
+  of \texttt{numofbytes} bytes starting at \texttt{ptr}. Pages
+  already touched are moved, which is more expensive than placing
+  them when they are touched first. Thus the function should be
+  called before the block is written to, if possible.
+*/
+
+void applymempolicy(void *ptr,Uint numofbytes)
+{
+  char *start;
+  Uint len;
+
+  if(numofbytes < HUGEPAGESIZE || !pagealign(ptr,numofbytes,&start,&len))
+  {
+    return;
+  }
+  if(usehugepages)
+  {
+    (void) madvise(start,(size_t) len,MADV_HUGEPAGE);
+  }
+  if(numofnumanodes > UintConst(1))
+  {
+    switch(numapolicy)
+    {
+      case NUMALOCAL:
+        bindrange(start,len,MPOL_LOCAL,0);
+        break;
+      case NUMAINTERLEAVE:
+      case NUMAREPLICATE:
+        bindrange(start,len,MPOL_INTERLEAVE,
+                  (numofnumanodes == (Uint) MAXNUMANODES)
+                    ? ~0UL
+                    : (1UL << numofnumanodes) - 1);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/*EE
+  The following function makes a copy of the read-only block of
+  \texttt{numofbytes} bytes starting at \texttt{ptr} on each NUMA node,
+  if the policy \texttt{NUMAREPLICATE} was chosen and there is more
+  than one node. The block must not be modified afterwards.
+  The copies are obtained via \texttt{nodelocalreplica}.
+*/
+
+void replicatereadonly(void *ptr,Uint numofbytes)
+{
+  Uint node;
+  Replicatedblock *block;
+  void *copy;
+
+  if(numapolicy != NUMAREPLICATE || numofnumanodes <= UintConst(1) ||
+     numofbytes < HUGEPAGESIZE ||
+     numofreplicated >= (Uint) MAXREPLICATEDBLOCKS)
+  {
+    return;
+  }
+  block = &replicated[numofreplicated++];
+  block->original = ptr;
+  block->numofbytes = numofbytes;
+  for(node = 0; node < numofnumanodes; node++)
+  {
+    copy = mmap(NULL,(size_t) numofbytes,PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,-1,(off_t) 0);
+    if(copy == MAP_FAILED)
+    {
+      block->copy[node] = NULL;
+      continue;
+    }
+    if(usehugepages)
+    {
+      (void) madvise(copy,(size_t) numofbytes,MADV_HUGEPAGE);
+    }
+    bindrange((char *) copy,numofbytes,MPOL_BIND,1UL << node);
+    memcpy(copy,ptr,(size_t) numofbytes);
+    (void) mprotect(copy,(size_t) numofbytes,PROT_READ);
+    block->copy[node] = copy;
+  }
+}
+
+/*EE
+  The following function delivers the copy of the block starting at
+  \texttt{ptr} on the NUMA node the calling thread runs on. If the block
+  was not replicated, then \texttt{ptr} is returned.
+*/
+
+void *nodelocalreplica(void *ptr)
+{
+  Uint i;
+  unsigned int cpu, node;
+
+  for(i=0; i<numofreplicated; i++)
+  {
+    if(replicated[i].original == ptr)
+    {
+      if(syscall(SYS_getcpu,&cpu,&node,NULL) != 0 ||
+         (Uint) node >= numofnumanodes ||
+         replicated[i].copy[node] == NULL)
+      {
+        return ptr;
+      }
+      return replicated[i].copy[node];
+    }
+  }
+  return ptr;
+}
+
+/*EE
+  The following function stores in \texttt{threadcopies[t]} the copy of
+  the block starting at \texttt{ptr} on the NUMA node of thread \(t\) of
+  a parallel region, as delivered by \texttt{nodelocalreplica} in this
+  thread. \texttt{threadcopies} must provide space for 
+  \texttt{omp\_get\_max\_threads()} pointers. If the block was not 
+  replicated, then all pointers are \texttt{ptr}. Since the copies are
+  determined once, the threads should be bound to their cores.
+*/
+
+void threadlocalreplicas(void *ptr,void **threadcopies)
+{
+  Uint thread, numofthreads = (Uint) omp_get_max_threads();
+
+  for(thread = 0; thread < numofthreads; thread++)
+  {
+    threadcopies[thread] = ptr;
+  }
+  if(numofreplicated == 0)
+  {
+    return;
+  }
+#pragma omp parallel
+  threadcopies[omp_get_thread_num()] = nodelocalreplica(ptr);
+}
+
+/*EE
+  The following function frees all replicated blocks.
+*/
+
+void freereplicas(void)
+{
+  Uint i, node;
+
+  for(i=0; i<numofreplicated; i++)
+  {
+    for(node = 0; node < numofnumanodes; node++)
+    {
+      if(replicated[i].copy[node] != NULL)
+      {
+        (void) munmap(replicated[i].copy[node],
+                      (size_t) replicated[i].numofbytes);
+        replicated[i].copy[node] = NULL;
+      }
+    }
+  }
+  numofreplicated = 0;
+}
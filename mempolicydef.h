@@ -0,0 +1,52 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mempolicydef.h
+ *
+ *    Description:  Placement policies for large index arrays
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 10:12:41
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+#ifndef MEMPOLICYDEF_H
+#define MEMPOLICYDEF_H
+#include "types.h"
+
+/*
+  The following type declares the possible NUMA placements of
+  large memory blocks. With \texttt{NUMANONE} the kernel default is used,
+  \texttt{NUMALOCAL} places pages on the node of the thread touching them
+  first, \texttt{NUMAINTERLEAVE} spreads the pages round robin over all
+  nodes, and \texttt{NUMAREPLICATE} additionally keeps one copy of the
+  read-only index per node.
+*/
+
+typedef enum
+{
+  NUMANONE = 0,
+  NUMALOCAL,
+  NUMAINTERLEAVE,
+  NUMAREPLICATE
+} Numapolicy;
+
+/*
+  Blocks smaller than a huge page are never subject to a placement policy.
+*/
+
+#define HUGEPAGESIZE      (UintConst(1) << 21)
+
+/*
+  The maximal number of NUMA nodes and of replicated blocks.
+*/
+
+#define MAXNUMANODES      64
+#define MAXREPLICATEDBLOCKS 8
+
+#endif
@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include "arraydef.h"
+#include "packedseq.h"
 
 //}
 
@@ -42,6 +43,14 @@
   \item
   \texttt{totallength} is the total length of the stored sequences 
   including the \(k-1\) separator characters.
+  \item
+  \texttt{seqnumsample} is \texttt{NULL} or, for each \(j\), stores 
+  the number of the sequence containing position 
+  \(j\cdot 2^{\texttt{samplebits}}\), see \texttt{sampleseqnums}.
+  \item
+  \texttt{packedsequence} is \texttt{NULL} or stores the sequence with 
+  2 bits per base, see \texttt{packmultiseq}. In the latter case 
+  \texttt{sequence} is \texttt{NULL}.
   \end{enumerate}
 */
 
@@ -89,12 +98,16 @@ struct Multiseq
   ArrayPosition markpos;
   Uint *startdesc,                     // of length numofsequences + 1
        numofsequences,                 // the number of sequences
-       totallength;                    // the total length of all sequences
+       totallength,                    // the total length of all sequences
+       *seqnumsample,                  // NULL or sequence number of every
+                                       // 2^samplebits-th position
+       samplebits;                     // log2 of the sampling distance
   ArrayCharacters descspace;           // the space for the descriptions
   Uchar *sequence,                     // the concatenated sequences
         *rcsequence,                   // NULL or points to 
                                        // reverse complemented sequences
         *originalsequence;             // NULL or points to orig. sequence
+  Packedseq *packedsequence;           // NULL or the packed sequence
 
 };                  // \Typedef{Multiseq}
 
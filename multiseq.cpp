@@ -17,6 +17,7 @@
 #include <omp.h>
 #include <pthread.h>
 #include <iostream>
+#include <algorithm>
 #include "types.h"
 #include "spacedef.h"
 #include "minmax.h"
@@ -78,6 +79,9 @@ void initmultiseq(Multiseq *multiseq)
   multiseq->rcsequence = NULL;
   multiseq->numofsequences = 0;
   multiseq->totallength = 0;
+  multiseq->seqnumsample = NULL;
+  multiseq->samplebits = 0;
+  multiseq->packedsequence = NULL;
 }
 
 
@@ -112,6 +116,12 @@ void freemultiseq(Multiseq *multiseq)
     FREESPACE(multiseq->sequence);
   }
   FREESPACE(multiseq->rcsequence);
+  FREESPACE(multiseq->seqnumsample);
+  if(multiseq->packedsequence != NULL)
+  {
+    freepackedseq(multiseq->packedsequence);
+    FREESPACE(multiseq->packedsequence);
+  }
 }
 
 /*EE
@@ -226,16 +236,105 @@ Sint getrecordnum(Uint *recordseps,Uint numofrecords,Uint totalwidth,
   return -1;
 }
 
+/*EE
+  For a multiple sequence with many short sequences, the binary search
+  in \texttt{getrecordnum} requires many dependent memory accesses for 
+  each position. The following function samples the sequence numbers
+  of the positions \(j\cdot 2^{b}\) for \(j\in[0,n/2^{b}]\), where
+  \(n\) is \texttt{totallength} and \(b\) is \texttt{samplebits}. 
+  Then the number of the sequence containing position \(p\) is at least 
+  \texttt{seqnumsample[}\(p/2^{b}\)\texttt{]} and at most
+  \texttt{seqnumsample[}\(p/2^{b}+1\)\texttt{]}, where the last entry 
+  is \(k-1\). If \texttt{samplebits} is 0, then \(b\) is the largest value
+  such that \(2^{b}\) does not exceed the average length of the sequences,
+  so that usually one or two separators have to be compared. A multiple
+  sequence without sequences is not sampled.
+*/
+
+#define MAXSAMPLEBITS UintConst(20)
+
+void sampleseqnums(Multiseq *multiseq,Uint samplebits)
+{
+  Uint numofsamples, sample, seqnum = 0, avglength,
+       numofseparators = multiseq->markpos.nextfreeUint;
+
+  if(multiseq->numofsequences == 0)
+  {
+    return;
+  }
+  if(samplebits == 0)
+  {
+    avglength = multiseq->totallength/multiseq->numofsequences;
+    while(samplebits < MAXSAMPLEBITS && 
+          (UintConst(1) << (samplebits+1)) <= avglength)
+    {
+      samplebits++;
+    }
+  }
+  multiseq->samplebits = samplebits;
+  numofsamples = (multiseq->totallength >> samplebits) + 1;
+  FREESPACE(multiseq->seqnumsample);
+  multiseq->seqnumsample = ALLOCSPACE(NULL,Uint,numofsamples+1);
+  for(sample = 0; sample < numofsamples; sample++)
+  {
+    while(seqnum < numofseparators && 
+          multiseq->markpos.spaceUint[seqnum] < (sample << samplebits))
+    {
+      seqnum++;
+    }
+    multiseq->seqnumsample[sample] = seqnum;
+  }
+  multiseq->seqnumsample[numofsamples] = multiseq->numofsequences - 1;
+}
+
+/*
+  The following function delivers the number of the sequence 
+  containing \texttt{position} by counting the separators before 
+  \texttt{position} between the two samples enclosing it. If there
+  are many of them, then they are binary searched.
+*/
+
+#define MAXLINEARSEPARATORS 8
+
+static Sint getsampledseqnum(Multiseq *multiseq,Uint position)
+{
+  Uint seqnum, lastseqnum, *markpos = multiseq->markpos.spaceUint;
+
+  if(position >= multiseq->totallength)
+  {
+    fprintf(stderr, "cannot find position %lu",(long unsigned int) position);
+    return -1;
+  }
+  seqnum = multiseq->seqnumsample[position >> multiseq->samplebits];
+  lastseqnum = multiseq->seqnumsample[(position >> multiseq->samplebits)+1];
+  if(lastseqnum - seqnum > MAXLINEARSEPARATORS)
+  {
+    return (Sint) (lower_bound(markpos + seqnum,markpos + lastseqnum,
+                               position) - markpos);
+  }
+  while(seqnum < lastseqnum && markpos[seqnum] < position)
+  {
+    seqnum++;
+  }
+  return (Sint) seqnum;
+}
+
 /*EE
   Given a \texttt{multiseq}, and a position in \texttt{multiseq->sequence},
   the function \texttt{getseqnum} delivers the sequence number for
   \texttt{position}. If this cannot be found, then a negative error code
   is returned. The running time of \texttt{getseqnum} is \(O(\log_{2}k)\),
-  where \(k\) is the number of sequences in \texttt{multiseq}.
+  where \(k\) is the number of sequences in \texttt{multiseq}. If the
+  sequence numbers have been sampled by \texttt{sampleseqnums}, then
+  only the separators between two samples are considered.
 */
 
 Sint getseqnum(Multiseq *multiseq,Uint position)
 {
+  if(multiseq->seqnumsample != NULL)
+  {
+    return getsampledseqnum(multiseq,position);
+  }
   return getrecordnum(multiseq->markpos.spaceUint,
                       multiseq->numofsequences,
                       multiseq->totallength,
@@ -274,3 +373,101 @@ Sint pos2pospair(Multiseq *multiseq,PairUint *pos,Uint position)
   return 0;
 }
 
+/*EE
+  The following function stores the sequence of \texttt{multiseq} with
+  2 bits per base in \texttt{packedsequence}. Afterwards the space for
+  \texttt{sequence} is released and \texttt{sequence} is \texttt{NULL},
+  so the characters must be accessed via the functions of 
+  \texttt{packedseq.cpp}.
+*/
+
+void packmultiseq(Multiseq *multiseq)
+{
+  multiseq->packedsequence = ALLOCSPACE(NULL,Packedseq,1);
+  packsequence(multiseq->packedsequence,multiseq->sequence,
+               multiseq->totallength);
+  if(multiseq->originalsequence == multiseq->sequence)
+  {
+    multiseq->originalsequence = NULL;
+  }
+  if(DELETEMEMORYMAP(multiseq->sequence) != 0)
+  {
+    FREESPACE(multiseq->sequence);
+  }
+  multiseq->sequence = NULL;
+}
+
+/*EE
+  The following function concatenates the \texttt{numofparts} records
+  of \texttt{parts} to the record \texttt{multiseq}, where consecutive 
+  parts are separated by the symbol \texttt{SEPARATOR}, as the sequences
+  within one part. \texttt{partstart[i]} is set to the position of the
+  first character of part \(i\) in \texttt{multiseq->sequence}, and
+  \texttt{partstart[numofparts]} is the total length plus 1. The space
+  of the parts is freed.
+*/
+
+void concatmultiseqs(Multiseq *multiseq,Multiseq *parts,Uint numofparts,
+                     Uint *partstart)
+{
+  Uint p, *markoffset, *descoffset, *recordoffset;
+
+  markoffset = ALLOCSPACE(NULL,Uint,numofparts+1);
+  descoffset = ALLOCSPACE(NULL,Uint,numofparts+1);
+  recordoffset = ALLOCSPACE(NULL,Uint,numofparts+1);
+  partstart[0] = markoffset[0] = descoffset[0] = recordoffset[0] = 0;
+  for(p = 0; p < numofparts; p++)
+  {
+    partstart[p+1] = partstart[p] + parts[p].totallength + 1;
+    markoffset[p+1] = markoffset[p] + parts[p].markpos.nextfreeUint + 1;
+    descoffset[p+1] = descoffset[p] + parts[p].descspace.nextfreeUchar;
+    recordoffset[p+1] = recordoffset[p] + parts[p].numofsequences;
+  }
+  initmultiseq(multiseq);
+  multiseq->originalsequence = NULL;
+  multiseq->numofsequences = recordoffset[numofparts];
+  multiseq->totallength = partstart[numofparts] - 1;
+  multiseq->sequence = ALLOCSPACE(NULL,Uchar,multiseq->totallength+1);
+  multiseq->startdesc = ALLOCSPACE(NULL,Uint,multiseq->numofsequences+1);
+  multiseq->startdesc[multiseq->numofsequences] = descoffset[numofparts];
+  CHECKARRAYSPACEMULTI(&multiseq->markpos,Uint,markoffset[numofparts]);
+  multiseq->markpos.nextfreeUint = markoffset[numofparts] - 1;
+  CHECKARRAYSPACEMULTI(&multiseq->descspace,Uchar,descoffset[numofparts]);
+  multiseq->descspace.nextfreeUchar = descoffset[numofparts];
+#pragma omp parallel for schedule(dynamic,1)
+  for(p = 0; p < numofparts; p++)
+  {
+    Uint i;
+
+    memcpy(multiseq->sequence + partstart[p],parts[p].sequence,
+           (size_t) parts[p].totallength);
+    for(i = 0; i < parts[p].markpos.nextfreeUint; i++)
+    {
+      multiseq->markpos.spaceUint[markoffset[p] + i]
+        = partstart[p] + parts[p].markpos.spaceUint[i];
+    }
+    if(p + 1 < numofparts)
+    {
+      multiseq->sequence[partstart[p+1] - 1] = SEPARATOR;
+      multiseq->markpos.spaceUint[markoffset[p+1] - 1] = partstart[p+1] - 1;
+    }
+    for(i = 0; i < parts[p].numofsequences; i++)
+    {
+      multiseq->startdesc[recordoffset[p] + i] 
+        = descoffset[p] + parts[p].startdesc[i];
+    }
+    if(parts[p].descspace.nextfreeUchar > 0)
+    {
+      memcpy(multiseq->descspace.spaceUchar + descoffset[p],
+             parts[p].descspace.spaceUchar,
+             (size_t) parts[p].descspace.nextfreeUchar);
+    }
+  }
+  for(p = 0; p < numofparts; p++)
+  {
+    freemultiseq(parts + p);
+  }
+  FREESPACE(markoffset);
+  FREESPACE(descoffset);
+  FREESPACE(recordoffset);
+}
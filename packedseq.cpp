@@ -0,0 +1,445 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  packedseq.cpp
+ *
+ *    Description:  Sequences stored with 2 bits per base
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 09:41:07
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+//\Ignore{
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <vector>
+#include <omp.h>
+#include "types.h"
+#include "minmax.h"
+#include "spacedef.h"
+#include "protodef.h"
+#include "packedseq.h"
+
+using namespace std;
+
+//}
+
+/*EE
+  This file implements the construction of a \texttt{Packedseq} and
+  the access to its characters. See \texttt{packedseq.h} for the
+  representation.
+*/
+
+/*
+  The following table maps a character to its 2 bit code, or to 4 if
+  the character is not a base.
+*/
+
+static Uchar basecode[UCHAR_MAX+1];
+static bool basecodeinitialized = false;
+
+static void initbasecode(void)
+{
+  Uint i;
+
+  if(basecodeinitialized)
+  {
+    return;
+  }
+  for(i = 0; i <= (Uint) UCHAR_MAX; i++)
+  {
+    basecode[i] = (Uchar) 4;
+  }
+  basecode['a'] = (Uchar) 0;
+  basecode['c'] = (Uchar) 1;
+  basecode['g'] = (Uchar) 2;
+  basecode['t'] = (Uchar) 3;
+  basecodeinitialized = true;
+}
+
+/*EE
+  The following function stores the \texttt{len} characters of
+  \texttt{seq} in the packed sequence \texttt{packedseq}. The words are
+  computed in parallel, where each thread handles groups of
+  \texttt{INTWORDSIZE} words, so that the bits in \texttt{runwords} are
+  not shared. The runs found by each thread are concatenated in the
+  order of the groups, and a run crossing the border of two groups
+  is joined.
+*/
+
+void packsequence(Packedseq *packedseq,Uchar *seq,Uint len)
+{
+  Uint numofgroups, group, run, numofruns;
+  Sint numofthreads = (Sint) omp_get_max_threads();
+  vector< vector<Ambiguityrun> > threadruns(numofthreads);
+  vector<Uint> groupthread, groupruns;
+
+  initbasecode();
+  packedseq->totallength = len;
+  packedseq->numofwords = (len + PACKEDBASESPERWORD - 1) >> LOGPACKEDBASES;
+  numofgroups = (packedseq->numofwords + INTWORDSIZE - 1) >> LOGWORDSIZE;
+  packedseq->words = ALLOCSPACE(NULL,Uint,packedseq->numofwords+1);
+  packedseq->runwords = ALLOCSPACE(NULL,Uint,numofgroups+1);
+  groupthread.resize(numofgroups);
+  groupruns.resize(numofgroups+1);
+#pragma omp parallel for schedule(static)
+  for(group = 0; group < numofgroups; group++)
+  {
+    vector<Ambiguityrun> &runs = threadruns[omp_get_thread_num()];
+    Uint word, pos, end, code, packed, flags = 0,
+         firstrun = (Uint) runs.size();
+
+    groupthread[group] = (Uint) omp_get_thread_num();
+    for(word = group << LOGWORDSIZE;
+        word < MIN((group+1) << LOGWORDSIZE,packedseq->numofwords); word++)
+    {
+      packed = 0;
+      end = MIN((word+1) << LOGPACKEDBASES,len);
+      for(pos = word << LOGPACKEDBASES; pos < end; pos++)
+      {
+        code = (Uint) basecode[seq[pos]];
+        if(code > UintConst(3))
+        {
+          if(runs.size() > firstrun && runs.back().symbol == seq[pos] &&
+             runs.back().start + runs.back().length == pos)
+          {
+            runs.back().length++;
+          } else
+          {
+            Ambiguityrun newrun = {pos,1,seq[pos]};
+
+            runs.push_back(newrun);
+          }
+          flags |= UintConst(1) << (word & (INTWORDSIZE-1));
+          code = 0;
+        }
+        packed |= code << ((pos & (PACKEDBASESPERWORD-1)) << 1);
+      }
+      packedseq->words[word] = packed;
+    }
+    packedseq->runwords[group] = flags;
+    groupruns[group] = (Uint) runs.size() - firstrun;
+  }
+  packedseq->words[packedseq->numofwords] = 0;
+  packedseq->runwords[numofgroups] = 0;
+  numofruns = 0;
+  for(group = 0; group < numofgroups; group++)
+  {
+    numofruns += groupruns[group];
+  }
+  packedseq->runs = ALLOCSPACE(NULL,Ambiguityrun,numofruns+1);
+  packedseq->numofruns = 0;
+  {
+    vector<Uint> nextrun(numofthreads,0);
+
+    for(group = 0; group < numofgroups; group++)
+    {
+      vector<Ambiguityrun> &runs = threadruns[groupthread[group]];
+
+      for(run = nextrun[groupthread[group]];
+          run < nextrun[groupthread[group]] + groupruns[group]; run++)
+      {
+        Ambiguityrun *last = packedseq->runs + packedseq->numofruns - 1;
+
+        if(packedseq->numofruns > 0 && last->symbol == runs[run].symbol &&
+           last->start + last->length == runs[run].start)
+        {
+          last->length += runs[run].length;
+        } else
+        {
+          packedseq->runs[packedseq->numofruns++] = runs[run];
+        }
+      }
+      nextrun[groupthread[group]] += groupruns[group];
+    }
+  }
+}
+
+/*EE
+  The following function frees the space of a packed sequence.
+*/
+
+void freepackedseq(Packedseq *packedseq)
+{
+  FREESPACE(packedseq->words);
+  FREESPACE(packedseq->runwords);
+  FREESPACE(packedseq->runs);
+}
+
+/*
+  The following function delivers the index of the first run which
+  ends after \texttt{position}, or \texttt{numofruns} if there is none.
+*/
+
+static Uint firstrunafter(Packedseq *packedseq,Uint position)
+{
+  Uint left = 0, right = packedseq->numofruns, mid;
+
+  while(left < right)
+  {
+    mid = left + DIV2(right - left);
+    if(packedseq->runs[mid].start + packedseq->runs[mid].length <= position)
+    {
+      left = mid + 1;
+    } else
+    {
+      right = mid;
+    }
+  }
+  return left;
+}
+
+/*EE
+  The following function delivers the character at \texttt{position}
+  in a word overlapping a run. It is called by \texttt{packedseqchar}.
+*/
+
+Uchar packedseqrunchar(Packedseq *packedseq,Uint position)
+{
+  Uint run = firstrunafter(packedseq,position);
+
+  if(run < packedseq->numofruns && packedseq->runs[run].start <= position)
+  {
+    return packedseq->runs[run].symbol;
+  }
+  return (Uchar) "acgt"[PACKEDCODE(packedseq,position)];
+}
+
+/*EE
+  The following function decodes the \texttt{len} characters starting
+  at \texttt{start} into \texttt{buffer}. The bases are decoded word by
+  word, and then the runs overlapping the range are written over them.
+*/
+
+void packedseqdecode(Packedseq *packedseq,Uchar *buffer,Uint start,Uint len)
+{
+  Uint pos, end = start + len, word, run;
+
+  for(pos = start; pos < end; )
+  {
+    word = packedseq->words[pos >> LOGPACKEDBASES] >>
+           ((pos & (PACKEDBASESPERWORD-1)) << 1);
+    do
+    {
+      buffer[pos - start] = (Uchar) "acgt"[word & UintConst(3)];
+      word >>= 2;
+      pos++;
+    } while(pos < end && (pos & (PACKEDBASESPERWORD-1)) != 0);
+  }
+  for(run = firstrunafter(packedseq,start);
+      run < packedseq->numofruns && packedseq->runs[run].start < end; run++)
+  {
+    for(pos = MAX(packedseq->runs[run].start,start);
+        pos < MIN(packedseq->runs[run].start + packedseq->runs[run].length,
+                  end); pos++)
+    {
+      buffer[pos - start] = packedseq->runs[run].symbol;
+    }
+  }
+}
+
+/*
+  The following function delivers the 32 bases starting at 
+  \texttt{position} in one word, the first base in the low bits. The 
+  word after the last word is 0, so it can always be read.
+*/
+
+static inline Uint packedbases(Packedseq *packedseq,Uint position)
+{
+  Uint word = position >> LOGPACKEDBASES,
+       shift = (position & (PACKEDBASESPERWORD-1)) << 1;
+
+  if(shift == 0)
+  {
+    return packedseq->words[word];
+  }
+  return (packedseq->words[word] >> shift) | 
+         (packedseq->words[word+1] << (INTWORDSIZE - shift));
+}
+
+/*
+  The following function checks if one of the \texttt{len} positions
+  starting at \texttt{position} may be part of a run.
+*/
+
+static inline bool packedrunoverlap(Packedseq *packedseq,Uint position,
+                                    Uint len)
+{
+  return (PACKEDRUNWORD(packedseq,position >> LOGPACKEDBASES) ||
+          PACKEDRUNWORD(packedseq,(position + len - 1) >> LOGPACKEDBASES))
+         ? true : false;
+}
+
+/*
+  The following macro delivers the mask of the 2 bit codes of the 
+  first \texttt{L} bases of a word.
+*/
+
+#define PACKEDMASK(L)\
+        (((L) >= PACKEDBASESPERWORD) ? ~UintConst(0)\
+                                     : ((UintConst(1) << ((L) << 1)) - 1))
+
+/*
+  The following macros operate on the 8 characters of a \texttt{Uint}.
+  \texttt{SWARBYTES(C)} repeats \texttt{C} in each byte, and 
+  \texttt{SWAREQUAL(X,C)} sets the high bit of each byte of \texttt{X}
+  which equals \texttt{C}. For a, c, g and t, the 2 bit code is the 
+  exclusive or of the bits 1 and 2 of the character with the bits 2 and
+  3, see \texttt{SWARCODES}.
+*/
+
+#define SWARBYTES(C)    (UintConst(0x0101010101010101) * (Uint) (C))
+#define SWARZERO(Y)     (~((((Y) & SWARBYTES(0x7F)) + SWARBYTES(0x7F)) |\
+                           (Y) | SWARBYTES(0x7F)))
+#define SWAREQUAL(X,C)  SWARZERO((X) ^ SWARBYTES(C))
+#define SWARCODES(X)    ((((X) >> 1) ^ ((X) >> 2)) & SWARBYTES(3))
+
+/*EE
+  The following function packs the longest prefix of the \texttt{len}
+  characters at \texttt{query}, \(\texttt{len}\leq 32\), consisting of 
+  a, c, g and t only into \texttt{*queryword} and delivers its length.
+  The characters are checked and converted 8 at a time.
+*/
+
+Uint packquerybases(Uchar *query,Uint len,Uint *queryword)
+{
+  Uint i, code, chunk, codes;
+
+  *queryword = 0;
+  for(i = 0; i + UintConst(8) <= len; i += UintConst(8))
+  {
+    memcpy(&chunk,query + i,sizeof(Uint));
+    if((SWAREQUAL(chunk,'a') | SWAREQUAL(chunk,'c') | 
+        SWAREQUAL(chunk,'g') | SWAREQUAL(chunk,'t')) != SWARBYTES(0x80))
+    {
+      break;
+    }
+    codes = SWARCODES(chunk);
+    codes = (codes | (codes >> 6)) & UintConst(0x000F000F000F000F);
+    codes = (codes | (codes >> 12)) & UintConst(0x000000FF000000FF);
+    codes = (codes | (codes >> 24)) & UintConst(0xFFFF);
+    *queryword |= codes << (i << 1);
+  }
+  for(/* Nothing */; i < len; i++)
+  {
+    code = (Uint) basecode[query[i]];
+    if(code > UintConst(3))
+    {
+      break;
+    }
+    *queryword |= code << (i << 1);
+  }
+  return i;
+}
+
+/*EE
+  The following function delivers the length of the longest common
+  prefix of the suffix of the packed sequence at \texttt{position} and
+  the \texttt{querylen} characters at \texttt{query}. The query is 
+  compared in blocks of 32 characters, each packed by 
+  \texttt{packquerybases}, by one exclusive or. For the first block, 
+  \texttt{queryword} and \texttt{querywordlen} are the result of 
+  \texttt{packquerybases} for \texttt{query}, so that a caller comparing
+  the same query to many positions packs it only once. A block in which
+  the subject overlaps a run or the query contains a character other
+  than a, c, g and t is compared character by character.
+*/
+
+Uint packedseqlcp(Packedseq *packedseq,Uint position,Uchar *query,
+                  Uint querylen,Uint queryword,Uint querywordlen)
+{
+  Uint len = 0, blocklen, i, diff;
+
+  querylen = MIN(querylen,packedseq->totallength - position);
+  while(len < querylen)
+  {
+    blocklen = MIN(querylen - len,PACKEDBASESPERWORD);
+    if(len > 0)
+    {
+      querywordlen = packquerybases(query + len,blocklen,&queryword);
+    }
+    if(querywordlen >= blocklen && 
+       !packedrunoverlap(packedseq,position + len,blocklen))
+    {
+      diff = (packedbases(packedseq,position + len) ^ queryword) 
+             & PACKEDMASK(blocklen);
+      if(diff != 0)
+      {
+        return len + ((Uint) __builtin_ctzl(diff) >> 1);
+      }
+    } else
+    {
+      for(i = 0; i < blocklen; i++)
+      {
+        if(packedseqchar(packedseq,position + len + i) != query[len+i])
+        {
+          return len + i;
+        }
+      }
+    }
+    len += blocklen;
+  }
+  return len;
+}
+
+/*EE
+  The following function compares the suffixes of the packed sequence
+  at \texttt{position1} and \texttt{position2} lexicographically, where
+  the end of the sequence is larger than all characters. It returns
+  a negative value, 0, or a positive value, if the first suffix is
+  smaller, equal, or larger than the second suffix. Since the codes of 
+  a, c, g and t are ordered like the characters, blocks of 32 bases 
+  outside of runs are compared by one exclusive or.
+*/
+
+Sint packedseqcompare(Packedseq *packedseq,Uint position1,Uint position2)
+{
+  Uint len1, len2, blocklen, i, diff;
+  Uchar cc1, cc2;
+
+  while(true)
+  {
+    len1 = packedseq->totallength - MIN(position1,packedseq->totallength);
+    len2 = packedseq->totallength - MIN(position2,packedseq->totallength);
+    if(len1 == 0 || len2 == 0)
+    {
+      return (len1 == len2) ? 0 : ((len1 == 0) ? 1 : -1);
+    }
+    blocklen = MIN(MIN(len1,len2),PACKEDBASESPERWORD);
+    if(!packedrunoverlap(packedseq,position1,blocklen) &&
+       !packedrunoverlap(packedseq,position2,blocklen))
+    {
+      diff = (packedbases(packedseq,position1) ^ 
+              packedbases(packedseq,position2)) & PACKEDMASK(blocklen);
+      if(diff != 0)
+      {
+        i = (Uint) __builtin_ctzl(diff) >> 1;
+        return (PACKEDCODE(packedseq,position1+i) < 
+                PACKEDCODE(packedseq,position2+i)) ? -1 : 1;
+      }
+    } else
+    {
+      for(i = 0; i < blocklen; i++)
+      {
+        cc1 = packedseqchar(packedseq,position1 + i);
+        cc2 = packedseqchar(packedseq,position2 + i);
+        if(cc1 != cc2)
+        {
+          return (cc1 < cc2) ? -1 : 1;
+        }
+      }
+    }
+    position1 += blocklen;
+    position2 += blocklen;
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  packedseq.h
+ *
+ *    Description:  Sequences stored with 2 bits per base
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 09:41:07
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+//\Ignore{
+
+#ifndef PACKEDSEQ_H
+#define PACKEDSEQ_H
+#include "types.h"
+#include "intbits.h"
+
+//}
+
+/*
+  A packed sequence stores the bases a, c, g and t with 2 bits each,
+  32 bases per \texttt{Uint}. All other characters, i.e.\ wildcards,
+  replaced wildcards and separators, are stored as maximal runs of the
+  same character in the side-table \texttt{runs}, sorted by their start.
+  Their 2 bits in \texttt{words} are 0. For each word, a bit in
+  \texttt{runwords} tells if the word overlaps a run, so that only these
+  words require a search in \texttt{runs}.
+*/
+
+#define PACKEDBASESPERWORD  UintConst(32)
+#define LOGPACKEDBASES      5
+
+struct Ambiguityrun
+{
+  Uint start,           // first position of the run
+       length;          // number of positions of the run
+  Uchar symbol;         // the character of the run
+};                   // \Typedef{Ambiguityrun}
+
+struct Packedseq
+{
+  Uint totallength,     // the number of characters
+       numofwords,      // the number of words in words
+       *words,          // 32 bases per word, the first base in the low bits
+       *runwords,       // bit i is set iff word i overlaps a run
+       numofruns;       // the number of runs
+  Ambiguityrun *runs;   // the runs of characters other than acgt
+};                   // \Typedef{Packedseq}
+
+/*
+  The following macro delivers the 2 bit code of the base at position
+  \texttt{P} of the packed sequence \texttt{PS}.
+*/
+
+#define PACKEDCODE(PS,P)\
+        (((PS)->words[(P) >> LOGPACKEDBASES] >>\
+          (((P) & (PACKEDBASESPERWORD-1)) << 1)) & UintConst(3))
+
+#define PACKEDRUNWORD(PS,W)\
+        (((PS)->runwords[(W) >> LOGWORDSIZE] >>\
+          ((W) & (INTWORDSIZE-1))) & UintConst(1))
+
+//\Ignore{
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+Uchar packedseqrunchar(Packedseq *packedseq,Uint position);
+#ifdef __cplusplus
+}
+#endif
+
+//}
+
+/*
+  The following function delivers the character at \texttt{position}.
+*/
+
+static inline Uchar packedseqchar(Packedseq *packedseq,Uint position)
+{
+  if(PACKEDRUNWORD(packedseq,position >> LOGPACKEDBASES))
+  {
+    return packedseqrunchar(packedseq,position);
+  }
+  return (Uchar) "acgt"[PACKEDCODE(packedseq,position)];
+}
+
+//\Ignore{
+
+#endif
+
+//}
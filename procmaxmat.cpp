@@ -15,7 +15,12 @@
 #include <math.h>
 #include <omp.h>
 #include <map>
+#include <algorithm>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 #include "types.h"
+#include "minmax.h"
 #include "errordef.h"
 #include "protodef.h"
 #include "spacedef.h"
@@ -40,12 +45,12 @@
   MUM candidates.
 */
 
-typedef Sint (*Findmatchfunction)(Uchar *,
-                                  Uint,
+typedef Sint (*Findmatchfunction)(Suffixtree *,
                                   Table &,
                                   Uint,
                                   Uint,
                                   Uint,
+                                  Probeoptions *,
                                   Processmatchfunction,
                                   void *,
                                   Uchar *,
@@ -53,15 +58,17 @@ typedef Sint (*Findmatchfunction)(Uchar *,
                                   Uint);
 
 /*
-  The following function is imported from \texttt{findmumcand.c}.
+  The following functions are imported from \texttt{findmumcand.c}.
 */
 
-Sint findmumcandidates(Uchar *reference,
-                       Uint referencelen,
+void showprobestatistics(void);
+
+Sint findmumcandidates(Suffixtree *stree,
                        Table &table,
                        Uint minmatchlength,
                        Uint chunks,
                        Uint prefix,
+                       Probeoptions *probeoptions,
                        Processmatchfunction processmatch,
                        void *processinfo,
                        Uchar *query,
@@ -72,12 +79,12 @@ Sint findmumcandidates(Uchar *reference,
   The following function is imported from \texttt{findmaxmat.c}
 */
 
-Sint findmaxmatches(Uchar *reference,
-                    Uint referencelen,
+Sint findmaxmatches(Suffixtree *stree,
                     Table &table,
                     Uint minmatchlength,
                     Uint chunks,
                     Uint prefix,
+                    Probeoptions *probeoptions,
                     Processmatchfunction processmatch,
                     void *processinfo,
                     Uchar *query,
@@ -88,25 +95,28 @@ Sint findmaxmatches(Uchar *reference,
   The following function is imported from \texttt{maxmatinp.c}
 */
 
-Sint scanmultiplefastafile (Multiseq *multiseq,
-                            char *filename,
-                            Uchar replacewildcardchar,
-                            Uchar *input,
-                            Uint inputlen);
+Sint overallqueryrecords(Multiseq *multiseq,
+                         char *filename,
+                         Uchar replacewildcardchar,
+                         void *applyinfo,
+                         Sint(*apply)(void *,Uint,Uchar *,Uint));
 
 //}
 
 /*EE
   The following code fragement is used when computing MUMs.
-  It calls the function \texttt{mumuniqueinquery}.
-  The MUM-candidates are stored in the dynamic 
-  array \texttt{mumcandtab}.  After the real MUMs are output, the table 
+  It collects the MUM-candidates stored by the threads in the dynamic 
+  array \texttt{mumcandtab} and calls the function 
+  \texttt{mumuniqueinquery}. After the real MUMs are output, the table 
   of MUM-candidates are declared to be empty.
 */
 
 #define PROCESSREALMUMS\
         if(matchprocessinfo->cmum)\
         {\
+          collectMUMcandidates(&matchprocessinfo->mumcandtab,\
+                               matchprocessinfo->threadmumcandtab,\
+                               matchprocessinfo->numofthreads);\
           if(mumuniqueinquery(info,\
                               matchprocessinfo->showstring ?\
                                  showseqandmaximalmatch :\
@@ -180,23 +190,135 @@ Sint scanmultiplefastafile (Multiseq *multiseq,
           }\
         }
 
+/*
+  The following table stores the complement of each character, as 
+  assigned by \texttt{ASSIGNMAXMATCOMPLEMENT}.
+*/
+
+static Uchar complementtable[UCHAR_MAX+1];
+
+#ifdef __SSSE3__
+
+/*
+  With SSSE3 instructions, blocks of 16 characters are complemented and
+  reversed by byte shuffles. All characters complemented to something
+  other than \texttt{n} are in the range from 0x60 to 0x7F, so their
+  complements are looked up by the low 4 bits in one of the following
+  two rows of \texttt{complementtable}. The characters 
+  \(\geq\texttt{MMREPLACEMENTCHARQUERY}\) are kept, and all other
+  characters become \texttt{n}.
+*/
+
+#define COMPLEMENTBLOCKSIZE 16
+
+static __m128i complementlow, complementhigh;
+
+#endif
+
+static void initcomplementtable(void)
+{
+  static bool initialized = false;
+  Uint cc;
+
+  if(initialized)
+  {
+    return;
+  }
+  for(cc = 0; cc <= (Uint) UCHAR_MAX; cc++)
+  {
+    ASSIGNMAXMATCOMPLEMENT(complementtable[cc],(Uchar) cc);
+  }
+#ifdef __SSSE3__
+  complementlow = _mm_loadu_si128((__m128i *) (complementtable + 0x60));
+  complementhigh = _mm_loadu_si128((__m128i *) (complementtable + 0x70));
+#endif
+  initialized = true;
+}
+
+#ifdef __SSSE3__
+
+/*
+  The following function delivers the reverse complement of the 16 
+  characters in \texttt{block}.
+*/
+
+static inline __m128i reversecomplementblock(__m128i block)
+{
+  __m128i lownibble = _mm_and_si128(block,_mm_set1_epi8(0x0F)),
+          highnibble = _mm_and_si128(_mm_srli_epi16(block,4),
+                                     _mm_set1_epi8(0x0F)),
+          keep = _mm_cmpeq_epi8(_mm_max_epu8(block,
+                                  _mm_set1_epi8((char) 
+                                                MMREPLACEMENTCHARQUERY)),
+                                block),
+          inlow = _mm_cmpeq_epi8(highnibble,_mm_set1_epi8(0x06)),
+          inhigh = _mm_cmpeq_epi8(highnibble,_mm_set1_epi8(0x07)),
+          other = _mm_or_si128(_mm_or_si128(inlow,inhigh),keep),
+          result;
+
+  result = _mm_or_si128(
+             _mm_or_si128(
+               _mm_and_si128(inlow,_mm_shuffle_epi8(complementlow,lownibble)),
+               _mm_and_si128(inhigh,
+                             _mm_shuffle_epi8(complementhigh,lownibble))),
+             _mm_or_si128(_mm_and_si128(keep,block),
+                          _mm_andnot_si128(other,_mm_set1_epi8('n'))));
+  return _mm_shuffle_epi8(result,_mm_set_epi8(0,1,2,3,4,5,6,7,
+                                              8,9,10,11,12,13,14,15));
+}
+
+#endif
+
+/*
+  Sequences of at least the following length are complemented in
+  parallel.
+*/
+
+#define MINPARALLELCOMPLEMENT (UintConst(1) << 20)
+
 /*
   The following function computes the Watson-Crick complement
   of the sequence pointed to by \texttt{seq}. The sequnce is
   of length \texttt{seqlen}. The result is computed in-place.
+  With SSSE3 instructions, the pairs of blocks of 16 characters at 
+  both ends are swapped and complemented as long as they do not 
+  overlap, and the remaining characters in the middle are swapped and
+  complemented one by one. Since the pairs are independent, long 
+  sequences are processed in parallel.
 */
 
 static void wccSequence (Uchar *seq,
                          Uint seqlen)
 {
-  Uchar *front, *back, tmp = 0;
+  Uint i, done = 0, half = DIV2(seqlen);
 
-  for (front = seq, back = seq + seqlen - 1; 
-       front <= back; front++, back--)
+  initcomplementtable();
+#ifdef __SSSE3__
+  done = (half / COMPLEMENTBLOCKSIZE) * COMPLEMENTBLOCKSIZE;
+#pragma omp parallel for schedule(static) if(seqlen >= MINPARALLELCOMPLEMENT)
+  for(i = 0; i < done; i += COMPLEMENTBLOCKSIZE)
   {
-    ASSIGNMAXMATCOMPLEMENT (tmp, *front);
-    ASSIGNMAXMATCOMPLEMENT (*front, *back);
-    *back = tmp;
+    __m128i front = _mm_loadu_si128((__m128i *) (seq + i)),
+            back = _mm_loadu_si128((__m128i *) 
+                                   (seq + seqlen - COMPLEMENTBLOCKSIZE - i));
+
+    _mm_storeu_si128((__m128i *) (seq + i),reversecomplementblock(back));
+    _mm_storeu_si128((__m128i *) (seq + seqlen - COMPLEMENTBLOCKSIZE - i),
+                     reversecomplementblock(front));
+  }
+#endif
+#pragma omp parallel for schedule(static) \
+        if(half - done >= MINPARALLELCOMPLEMENT)
+  for(i = done; i < half; i++)
+  {
+    Uchar tmp = complementtable[seq[i]];
+
+    seq[i] = complementtable[seq[seqlen - 1 - i]];
+    seq[seqlen - 1 - i] = tmp;
+  }
+  if(seqlen & UintConst(1))
+  {
+    seq[half] = complementtable[seq[half]];
   }
 }
 
@@ -273,47 +395,47 @@ static Sint showmaximalmatch (void *info,
                               /*@unused@*/ Uint seqnum,
                               Uint querystart)
 {
-  /*if  (N >= Size - 1)
-  {
-      Size *= 2;
-      A = (Match_t *) Safe_realloc (A, Size * sizeof (Match_t));
-  }
-  N++;
-  */
   Matchprocessinfo *matchprocessinfo = (Matchprocessinfo *) info;
 
-  if(matchprocessinfo->subjectmultiseq->numofsequences == UintConst(1)  && !matchprocessinfo->fourcolumn)
+  if(matchprocessinfo->subjectmultiseq->numofsequences == UintConst(1)
+     && !matchprocessinfo->fourcolumn)
   {
-    //A[N].R = (long unsigned int) (subjectstart+1);
+    printf("%8lu  ",(long unsigned int) (subjectstart+1));
   } else
   {       
     PairUint pp;
 
     if(pos2pospair(matchprocessinfo->subjectmultiseq,&pp,subjectstart) != 0)
-     return -1;
-    pp.uint0 = 0;
-    pp.uint1 = subjectstart;
-    showsequencedescription(matchprocessinfo->subjectmultiseq,matchprocessinfo->maxdesclength,pp.uint0);
-    //A[N].R =(long unsigned int) (pp.uint1+1);
+    {
+      return -1;
+    }
+    showsequencedescription(matchprocessinfo->subjectmultiseq,
+                            matchprocessinfo->maxdesclength,
+                            pp.uint0);
+    printf("  %8lu  ",(long unsigned int) (pp.uint1+1));
   }
-  if(matchprocessinfo->currentisrcmatch && matchprocessinfo->showreversepositions)
+  if(matchprocessinfo->currentisrcmatch && 
+     matchprocessinfo->showreversepositions)
   {
-    //A[N].Q = (long unsigned int) (matchprocessinfo->currentquerylen - querystart);
+    printf("%8lu  ",(long unsigned int) 
+                    (matchprocessinfo->currentquerylen - querystart));
   } else
   {
-    //A[N].Q = (long unsigned int) (querystart+1);
+    printf("%8lu  ",(long unsigned int) (querystart+1));
   }
-  //A[N].Len = (long unsigned int) matchlength;
-  //A[N].Good = true;
-  //A[N].Tentative = false;
+  printf("%8lu\n",(long unsigned int) matchlength);
   return 0;
 }
 
 /*
   The following function shows the same information as the previous
-  function and additionally the sequence information.
+  function and additionally the sequence information. If the 
+  subject-sequence is packed, then the match is decoded in blocks of
+  the following size.
 */
 
+#define PACKEDOUTPUTBLOCK 4096
+
 static Sint showseqandmaximalmatch (void *info,
                                     Uint matchlength,
                                     Uint subjectstart,
@@ -321,19 +443,39 @@ static Sint showseqandmaximalmatch (void *info,
                                     Uint querystart)
 {
   Matchprocessinfo *matchprocessinfo = (Matchprocessinfo *) info;
+  Multiseq *subjectmultiseq = matchprocessinfo->subjectmultiseq;
+  Uchar block[PACKEDOUTPUTBLOCK];
+  Uint offset, blocklen;
 
   (void) showmaximalmatch (info,
                            matchlength,
                            subjectstart,
                            seqnum,
                            querystart);
-  if (fwrite (matchprocessinfo->subjectmultiseq->sequence + subjectstart, 
-              sizeof (Uchar), 
-              (size_t) matchlength,
-              stdout) != (size_t) matchlength)
+  if(subjectmultiseq->packedsequence != NULL)
   {
-    fprintf(stderr, "cannot output string of length %lu", (long unsigned int) matchlength);
-    return -1;
+    for(offset = 0; offset < matchlength; offset += blocklen)
+    {
+      blocklen = MIN(matchlength - offset,(Uint) PACKEDOUTPUTBLOCK);
+      packedseqdecode(subjectmultiseq->packedsequence,block,
+                      subjectstart + offset,blocklen);
+      if (fwrite (block,sizeof (Uchar),(size_t) blocklen,stdout) 
+          != (size_t) blocklen)
+      {
+        fprintf(stderr, "cannot output string of length %lu", (long unsigned int) matchlength);
+        return -1;
+      }
+    }
+  } else
+  {
+    if (fwrite (subjectmultiseq->sequence + subjectstart, 
+                sizeof (Uchar), 
+                (size_t) matchlength,
+                stdout) != (size_t) matchlength)
+    {
+      fprintf(stderr, "cannot output string of length %lu", (long unsigned int) matchlength);
+      return -1;
+    }
   }
   printf ("\n");
   return 0;
@@ -341,34 +483,187 @@ static Sint showseqandmaximalmatch (void *info,
 
 /*
   The following function stores the information about a MUM-candidate
-  in the next free position of the dynamic array \texttt{mumcandtab}.
+  in the next free position of the dynamic array of the calling thread.
+  So the threads need not synchronize. The function must not be called 
+  from a nested parallel region.
 */
 
 static Sint storeMUMcandidate (void *info, Uint matchlength, Uint subjectstart, Uint seqnum, Uint querystart)
 {
-/*#pragma omp shared (A,size)
+  Matchprocessinfo *matchprocessinfo = (Matchprocessinfo *) info;
+  MUMcandidate *mumcandptr;
+
+  GETNEXTFREEINARRAY(mumcandptr,
+                     matchprocessinfo->threadmumcandtab + omp_get_thread_num(),
+                     MUMcandidate,1024);
+  mumcandptr->mumlength = matchlength;
+  mumcandptr->dbstart = subjectstart;
+  mumcandptr->queryseq = seqnum;
+  mumcandptr->querystart = querystart;
+  return 0;
+}
+
+/*
+  With option \texttt{-rcindex}, the text of the suffix tree or of the
+  table is the subject-sequence \(S\) of length \(m\), followed by a
+  separator and the reverse complement of \(S\). So a match of length
+  \(l\) at position \(p>m\) of the text and at position \(q\) of the
+  query is a match of the reverse complemented query at position 
+  \(n-q-l\), where \(n\) is the length of the query, and at position
+  \(2m+1-p-l\) of \(S\). The matches are separated by the following
+  function into the matches on the forward and on the reverse strand,
+  where the latter are mapped to these positions.
+*/
+
+static Sint storercindexmatch(void *info,
+                              Uint matchlength,
+                              Uint subjectstart,
+                              /*@unused@*/ Uint seqnum,
+                              Uint querystart)
+{
+  Matchprocessinfo *matchprocessinfo = (Matchprocessinfo *) info;
+  Uint subjectlen = matchprocessinfo->subjectmultiseq->totallength;
+  ThreeUint *matchptr;
+
+  if(subjectstart < subjectlen)
+  {
+    if(matchprocessinfo->forward)
     {
-  if  (N >= Size - 1)
+      GETNEXTFREEINARRAY(matchptr,&matchprocessinfo->forwardmatches,
+                         ThreeUint,1024);
+      matchptr->uint0 = querystart;
+      matchptr->uint1 = subjectstart;
+      matchptr->uint2 = matchlength;
+    }
+  } else
   {
-      Size *= 2;
-      A = (Match_t *) Safe_realloc (A, Size * sizeof (Match_t));
+    if(matchprocessinfo->reversecomplement)
+    {
+      GETNEXTFREEINARRAY(matchptr,&matchprocessinfo->reversematches,
+                         ThreeUint,1024);
+      matchptr->uint0 = matchprocessinfo->currentquerylen - querystart 
+                        - matchlength;
+      matchptr->uint1 = 2 * subjectlen + 1 - subjectstart - matchlength;
+      matchptr->uint2 = matchlength;
+    }
   }
-  N++;
-  A[N].R = subjectstart;
-  A[N].Q = querystart;
-  A[N].Len = matchlength;
-    }*/
-#pragma omp critical
+  return 0;
+}
+
+/*
+  The matches of each strand are reported in the order in which they
+  are reported for a subject-sequence without its reverse complement, 
+  i.e.\ sorted by their start in the query, and the matches with the 
+  same start sorted in lexicographic order of their suffixes of the 
+  subject-sequence, where the end of the subject-sequence is larger 
+  than all characters. The matches are stored as triples of the start
+  in the query, the start in the subject-sequence, and the length.
+*/
+
+struct Byquerystartandsuffix
+{
+  Uchar *text, *textend;
+  bool operator()(const ThreeUint &a,const ThreeUint &b) const
   {
-  Matchprocessinfo *matchprocessinfo = (Matchprocessinfo *) info;
-  MUMcandidate *mumcandptr;
-  //fprintf(stdout,"%lu,%lu,%lu\n",subjectstart,querystart,matchlength);
-  //GETNEXTFREEINARRAY(mumcandptr, &matchprocessinfo->mumcandtab, MUMcandidate,1024);
+    Uchar *ptr1, *ptr2;
+
+    if(a.uint0 != b.uint0)
+    {
+      return a.uint0 < b.uint0;
+    }
+    ptr1 = text + a.uint1 + MIN(a.uint2,b.uint2);
+    ptr2 = text + b.uint1 + MIN(a.uint2,b.uint2);
+    while(ptr1 < textend && ptr2 < textend && *ptr1 == *ptr2)
+    {
+      ptr1++;
+      ptr2++;
+    }
+    if(ptr1 == textend)
+    {
+      return false;
+    }
+    if(ptr2 == textend)
+    {
+      return true;
+    }
+    return *ptr1 < *ptr2;
+  }
+};
+
+/*
+  The following function sorts the matches in \texttt{matches} and 
+  applies \texttt{processmatch} to them. Afterwards the array is 
+  declared to be empty.
+*/
+
+static Sint processrcindexmatches(Matchprocessinfo *matchprocessinfo,
+                                  ArrayThreeUint *matches,
+                                  Processmatchfunction processmatch,
+                                  Uint seqnum)
+{
+  Byquerystartandsuffix byquerystartandsuffix 
+    = {matchprocessinfo->subjectmultiseq->sequence,
+       matchprocessinfo->subjectmultiseq->sequence + 
+       matchprocessinfo->subjectmultiseq->totallength};
+  ThreeUint *matchptr;
+
+  sort(matches->spaceThreeUint,
+       matches->spaceThreeUint + matches->nextfreeThreeUint,
+       byquerystartandsuffix);
+  for(matchptr = matches->spaceThreeUint; 
+      matchptr < matches->spaceThreeUint + matches->nextfreeThreeUint;
+      matchptr++)
+  {
+    if(processmatch(matchprocessinfo,matchptr->uint2,matchptr->uint1,
+                    seqnum,matchptr->uint0) != 0)
+    {
+      return -1;
+    }
+  }
+  matches->nextfreeThreeUint = 0;
+  return 0;
+}
+
+/*
+  The following function finds the matches on both strands of the 
+  current query by one scan of the unmodified query, and then reports 
+  the matches of each strand.
+*/
+
+static Sint findrcindexmatches(Matchprocessinfo *matchprocessinfo,
+                               Findmatchfunction findmatchfunction,
+                               Processmatchfunction processmatch,
+                               Uint seqnum,
+                               Uchar *query,
+                               Uint querylen)
+{
+  if(findmatchfunction(&matchprocessinfo->stree, matchprocessinfo->table, matchprocessinfo->minmatchlength, matchprocessinfo->chunks, matchprocessinfo->prefix, &matchprocessinfo->probeoptions, storercindexmatch, (void *) matchprocessinfo, query, querylen,
+                       seqnum) != 0)
+  {
+    return -1;
+  }
+  if(matchprocessinfo->forward)
+  {
+    showsequenceheader(&matchprocessinfo->querymultiseq, matchprocessinfo->showsequencelengths, false, seqnum, querylen);
+    matchprocessinfo->currentisrcmatch = false;
+    if(processrcindexmatches(matchprocessinfo,
+                             &matchprocessinfo->forwardmatches,
+                             processmatch,seqnum) != 0)
+    {
+      return -2;
+    }
+  }
+  if(matchprocessinfo->reversecomplement)
+  {
+    showsequenceheader(&matchprocessinfo->querymultiseq, matchprocessinfo->showsequencelengths, true, seqnum, querylen);
+    matchprocessinfo->currentisrcmatch = true;
+    if(processrcindexmatches(matchprocessinfo,
+                             &matchprocessinfo->reversematches,
+                             processmatch,seqnum) != 0)
+    {
+      return -3;
+    }
   }
-  /*mumcandptr->mumlength = matchlength;
-  mumcandptr->dbstart = subjectstart;
-  mumcandptr->queryseq = seqnum;
-  mumcandptr->querystart = querystart;*/
   return 0;
 }
 
@@ -388,7 +683,8 @@ static Sint findmaxmatchesonbothstrands(void *info,Uint seqnum,
   if(matchprocessinfo->cmum)
   { 
     processmatch = storeMUMcandidate;
-    findmatchfunction = findmumcandidates;
+    findmatchfunction = matchprocessinfo->probeoptions.leafcounts 
+                          ? findmaxmatches : findmumcandidates;
    } else
   {  
     if(matchprocessinfo->showstring)
@@ -400,22 +696,30 @@ static Sint findmaxmatchesonbothstrands(void *info,Uint seqnum,
     }
     if(matchprocessinfo->cmumcand)
     {
-      findmatchfunction = findmumcandidates;
+      processmatch = NULL;  // the MUM-candidates are only computed
+      findmatchfunction = matchprocessinfo->probeoptions.leafcounts 
+                            ? findmaxmatches : findmumcandidates;
     }  else
     { 
       findmatchfunction = findmaxmatches;
     }
   }
   matchprocessinfo->currentquerylen = querylen;
+  if(matchprocessinfo->rcindex)
+  {
+    return findrcindexmatches(matchprocessinfo,findmatchfunction,
+                              processmatch,seqnum,query,querylen);
+  }
   if(matchprocessinfo->forward)
   {
     showsequenceheader(&matchprocessinfo->querymultiseq, matchprocessinfo->showsequencelengths, false, seqnum, querylen);
     matchprocessinfo->currentisrcmatch = false;
-    if(findmatchfunction(matchprocessinfo->stree.text, matchprocessinfo->stree.textlen, matchprocessinfo->table, matchprocessinfo->minmatchlength, matchprocessinfo->chunks, matchprocessinfo->prefix, processmatch, info, query, querylen,
+    if(findmatchfunction(&matchprocessinfo->stree, matchprocessinfo->table, matchprocessinfo->minmatchlength, matchprocessinfo->chunks, matchprocessinfo->prefix, &matchprocessinfo->probeoptions, processmatch, info, query, querylen,
                          seqnum) != 0)
     {
       return -1;
     }
+    PROCESSREALMUMS;
   } 
   if(matchprocessinfo->reversecomplement)
   {
@@ -430,11 +734,12 @@ static Sint findmaxmatchesonbothstrands(void *info,Uint seqnum,
                        querylen);
     wccSequence(query,querylen);
     matchprocessinfo->currentisrcmatch = true;
-    if(findmatchfunction(matchprocessinfo->stree.text, matchprocessinfo->stree.textlen, matchprocessinfo->table, matchprocessinfo->minmatchlength, matchprocessinfo->chunks, matchprocessinfo->prefix, processmatch, info, query, querylen,
+    if(findmatchfunction(&matchprocessinfo->stree, matchprocessinfo->table, matchprocessinfo->minmatchlength, matchprocessinfo->chunks, matchprocessinfo->prefix, &matchprocessinfo->probeoptions, processmatch, info, query, querylen,
                          seqnum) != 0)
     {
       return -2;
     }
+    PROCESSREALMUMS;
   }
   return 0;
 } 
@@ -459,10 +764,32 @@ static Sint getmaxdesclen(Multiseq *multiseq)
   return (Sint) maxdesclen;
 }
 
+/*
+  The following function delivers the text indexed with option 
+  \texttt{-rcindex}, i.e.\ the subject-sequence, followed by a separator
+  and the reverse complement of the subject-sequence.
+*/
+
+static Uchar *makercindextext(Multiseq *subjectmultiseq)
+{
+  Uint subjectlen = subjectmultiseq->totallength;
+  Uchar *text = ALLOCSPACE(NULL,Uchar,2 * subjectlen + 2);
+
+  memcpy(text,subjectmultiseq->sequence,(size_t) subjectlen);
+  text[subjectlen] = (Uchar) SEPARATOR;
+  memcpy(text + subjectlen + 1,subjectmultiseq->sequence,(size_t) subjectlen);
+  wccSequence(text + subjectlen + 1,subjectlen);
+  text[2 * subjectlen + 1] = (Uchar) SEPARATOR;
+  return text;
+}
+
 /*EE
-  The following function constructs the suffix tree,
+  The following function constructs the suffix tree (unless only the
+  minimizers or every step-th suffix of the subject-sequence are indexed),
   initializes the \texttt{Matchprocessinfo}-record appropriately,
   initializes the dynamic array \texttt{mumcandtab} (if necessary),
+  or, with option \texttt{-rcindex}, for the subject-sequence followed 
+  by its reverse complement,
   and then iterates the function \texttt{findmaxmatchesonbothstrands}
   over all sequences in \texttt{querymultiseq}. Finally, the space
   allocated for the suffix tree and the space for \texttt{mumcandtab}
@@ -472,23 +799,47 @@ static Sint getmaxdesclen(Multiseq *multiseq)
 Sint procmaxmatches(MMcallinfo *mmcallinfo,Multiseq *subjectmultiseq)
 { 
   Matchprocessinfo matchprocessinfo;
-  Uint filenum, filelen, dsl=0;
+  Uint filenum, dsl=0;
   Sint retcode;
-  Uchar *filecontent;
   Location ploc;
   double start, finish;
   double start1, finish1;
   Table table;
+  Uchar *text = subjectmultiseq->sequence;
+  Uint textlen = subjectmultiseq->totallength;
   //fprintf(stderr,"# construct suffix tree for sequence of length %lu\n", (long unsigned int) subjectmultiseq->totallength);
   /* fprintf(stderr,"# (maximum reference length is %lu)\n", (long unsigned int) getmaxtextlenstree());
   fprintf(stderr,"# (maximum query length is %lu)\n", (long unsigned int) ~((Uint)0));*/
   start = omp_get_wtime();
-  if(constructprogressstree (&matchprocessinfo.stree,subjectmultiseq->sequence,subjectmultiseq->totallength,NULL,NULL,NULL) != 0)
-    return -1;
+  if(mmcallinfo->rcindex)
+  {
+    text = makercindextext(subjectmultiseq);
+    textlen = 2 * textlen + 1;
+  }
+  if(mmcallinfo->probeoptions.minimizerwindow > 0 ||
+     mmcallinfo->probeoptions.sparsestep > 0)
+  {
+    matchprocessinfo.stree.text = text;
+    matchprocessinfo.stree.textlen = textlen;
+  } else
+  {
+    if(constructprogressstree (&matchprocessinfo.stree,text,textlen,NULL,NULL,NULL) != 0)
+      return -1;
+    if(mmcallinfo->probeoptions.leafcounts)
+    {
+      computeleafcounts(&matchprocessinfo.stree);
+    }
+  }
   finish = omp_get_wtime();
+  if(!mmcallinfo->packsubject)
+  {
+    replicatereadonly(matchprocessinfo.stree.text,
+                      matchprocessinfo.stree.textlen+1);
+  }
   matchprocessinfo.subjectmultiseq = subjectmultiseq;
   matchprocessinfo.minmatchlength = mmcallinfo->minmatchlength;
   matchprocessinfo.showstring = mmcallinfo->showstring;
+  matchprocessinfo.verbose = mmcallinfo->verbose;
   matchprocessinfo.showsequencelengths = mmcallinfo->showsequencelengths;
   matchprocessinfo.showreversepositions = mmcallinfo->showreversepositions;
   matchprocessinfo.forward = mmcallinfo->forward;
@@ -496,15 +847,37 @@ Sint procmaxmatches(MMcallinfo *mmcallinfo,Multiseq *subjectmultiseq)
   matchprocessinfo.cmum = mmcallinfo->cmum;
   matchprocessinfo.cmumcand = mmcallinfo->cmumcand;
   matchprocessinfo.reversecomplement = mmcallinfo->reversecomplement;
+  matchprocessinfo.rcindex = mmcallinfo->rcindex;
+  matchprocessinfo.numofshards = mmcallinfo->shards ? mmcallinfo->numofshards
+                                                    : 0;
+  matchprocessinfo.shardstart = mmcallinfo->shardstart;
+  matchprocessinfo.shardfilelist = mmcallinfo->shardfilelist;
+  INITARRAY(&matchprocessinfo.forwardmatches,ThreeUint);
+  INITARRAY(&matchprocessinfo.reversematches,ThreeUint);
   matchprocessinfo.chunks = mmcallinfo->chunks;
   matchprocessinfo.prefix = mmcallinfo->prefix;
+  matchprocessinfo.probeoptions = mmcallinfo->probeoptions;
   matchprocessinfo.table = table;
   start1 = omp_get_wtime();
   createTable(&matchprocessinfo);
   finish1 = omp_get_wtime();
+  if(mmcallinfo->packsubject)
+  {
+    packmultiseq(subjectmultiseq);
+    matchprocessinfo.stree.text = NULL;
+    matchprocessinfo.probeoptions.packedtext 
+      = subjectmultiseq->packedsequence;
+  }
   if(mmcallinfo->cmum)
   {
     INITARRAY(&matchprocessinfo.mumcandtab,MUMcandidate);
+    matchprocessinfo.numofthreads = (Uint) omp_get_max_threads();
+    matchprocessinfo.threadmumcandtab 
+      = ALLOCSPACE(NULL,ArrayMUMcandidate,matchprocessinfo.numofthreads);
+    for(Uint thread = 0; thread < matchprocessinfo.numofthreads; thread++)
+    {
+      INITARRAY(matchprocessinfo.threadmumcandtab + thread,MUMcandidate);
+    }
   }
   retcode = getmaxdesclen(subjectmultiseq);
   if(retcode < 0)
@@ -512,29 +885,37 @@ Sint procmaxmatches(MMcallinfo *mmcallinfo,Multiseq *subjectmultiseq)
     return -2;
   }
   matchprocessinfo.maxdesclength = (Uint) retcode;
+  if(subjectmultiseq->numofsequences > UintConst(1))
+  {
+    sampleseqnums(subjectmultiseq,0);
+  }
   for(filenum=0; filenum < mmcallinfo->numofqueryfiles; filenum++)
   {
-    filecontent = (Uchar *) CREATEMEMORYMAP (mmcallinfo->queryfilelist[filenum],true,&filelen);
-    if (filecontent == NULL || filelen == 0)
-    {
-      fprintf(stderr, "cannot open file \"%s\" or file \"%s\" is empty",mmcallinfo->queryfilelist[filenum],mmcallinfo->queryfilelist[filenum]);
-      return -3;
-    }
-    if (scanmultiplefastafile (&matchprocessinfo.querymultiseq,mmcallinfo->queryfilelist[filenum],mmcallinfo->matchnucleotidesonly ? MMREPLACEMENTCHARQUERY : 0,
-                               filecontent, filelen) != 0)
+    if (overallqueryrecords (&matchprocessinfo.querymultiseq,mmcallinfo->queryfilelist[filenum],mmcallinfo->matchnucleotidesonly ? MMREPLACEMENTCHARQUERY : 0,
+                             (void *) &matchprocessinfo,findmaxmatchesonbothstrands) != 0)
     {
       return -4;
     }
-    //fprintf(stderr, "# matching query-file \"%s\"\n# against subject-file \"%s\"\n", mmcallinfo->queryfilelist[filenum], mmcallinfo->subjectfile);
-    if (overallsequences (false,&matchprocessinfo.querymultiseq,(void *) &matchprocessinfo,findmaxmatchesonbothstrands) != 0)
-    { 
-      return -5;
-    }
-    freemultiseq(&matchprocessinfo.querymultiseq);
   }
   if(mmcallinfo->cmum)
   {
     FREEARRAY(&matchprocessinfo.mumcandtab,MUMcandidate);
+    for(Uint thread = 0; thread < matchprocessinfo.numofthreads; thread++)
+    {
+      FREEARRAY(matchprocessinfo.threadmumcandtab + thread,MUMcandidate);
+    }
+    FREESPACE(matchprocessinfo.threadmumcandtab);
+  }
+  if(mmcallinfo->verbose)
+  {
+    showprobestatistics();
+  }
+  FREEARRAY(&matchprocessinfo.forwardmatches,ThreeUint);
+  FREEARRAY(&matchprocessinfo.reversematches,ThreeUint);
+  freereplicas();
+  if(mmcallinfo->rcindex)
+  {
+    FREESPACE(text);
   }
   cerr << "createST=" << finish-start << ",";
   cerr << "createTable=" << finish1-start1 << ",";
@@ -16,18 +16,25 @@
 #include "optdesc.h"
 #include "multidef.h"
 #include "mumcand.h"
+#include "mempolicydef.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
 Sint mumuniqueinquery(void *processinfo,
                       Sint (*processmum)(void *,Uint,Uint,Uint,Uint),
                       ArrayMUMcandidate *mumcand);
+void collectMUMcandidates(ArrayMUMcandidate *mumcand,
+                          ArrayMUMcandidate *threadmumcand,
+                          Uint numofthreads);
 Sint simplefileOpen(char *filename,Uint *numofbytes);
 /*@null@*/ void *creatememorymapforfiledesc(char *file,Uint line,Sint fd,
                                             bool writemap,Uint numofbytes);
 /*@null@*/ void *creatememorymap(char *file,Uint line,char *filename,
                                  bool writemap,Uint *numofbytes);
 Sint deletememorymap(char *file,Uint line,void *mappedfile);
+bool gzipcompressed(Uchar *content,Uint len);
+/*@null@*/ Uchar *inflatefilecontent(char *filename,Uchar *content,Uint len,
+                                     Uint *outlen);
 void mmcheckspaceleak(void);
 Sint mmwrapspace(void);
 void mmshowspace(void);
@@ -38,8 +45,19 @@ Sint overallsequences(bool rcmode,Multiseq *multiseq,void *applyinfo,
                       Sint(*apply)(void *,Uint,Uchar *,Uint));
 Sint getrecordnum(Uint *recordseps,Uint numofrecords,Uint totalwidth,
                   Uint position);
+void sampleseqnums(Multiseq *multiseq,Uint samplebits);
 Sint getseqnum(Multiseq *multiseq,Uint position);
 Sint pos2pospair(Multiseq *multiseq,PairUint *pos,Uint position);
+void packmultiseq(Multiseq *multiseq);
+void concatmultiseqs(Multiseq *multiseq,Multiseq *parts,Uint numofparts,
+                     Uint *partstart);
+void packsequence(Packedseq *packedseq,Uchar *seq,Uint len);
+void freepackedseq(Packedseq *packedseq);
+void packedseqdecode(Packedseq *packedseq,Uchar *buffer,Uint start,Uint len);
+Uint packquerybases(Uchar *query,Uint len,Uint *queryword);
+Uint packedseqlcp(Packedseq *packedseq,Uint position,Uchar *query,
+                  Uint querylen,Uint queryword,Uint querywordlen);
+Sint packedseqcompare(Packedseq *packedseq,Uint position1,Uint position2);
 void initoptions(OptionDescription *options,Uint numofoptions);
 Sint addoption(OptionDescription *options,Uint numofoptions,
                Uint optnum,char *optname,char *optdesc);
@@ -62,12 +80,21 @@ void reseterror(void);
 /*@notnull@*/ void *allocandusespaceviaptr(char *file,Uint line,
                                            /*@null@*/ void *ptr,
                                            Uint size,Uint number);
+/*@null@*/ void *reservespaceviaptr(char *file,Uint line,Uint size,
+                                    Uint number);
 /*@notnull@*/ char *dynamicstrdup(char *file,Uint line,char *source);
 void freespaceviaptr(char *file,Uint line,void *ptr);
 void wrapspace(void);
+void setmempolicy(bool hugepages,Numapolicy policy);
+void applymempolicy(void *ptr,Uint numofbytes);
+void replicatereadonly(void *ptr,Uint numofbytes);
+void *nodelocalreplica(void *ptr);
+void threadlocalreplicas(void *ptr,void **threadcopies);
+void freereplicas(void);
 void activeblocks(void);
 void checkspaceleak(void);
 void showspace(void);
+Uint getcurrentspace(void);
 Uint getspacepeak(void);
 void showmemsize(void);
 Uint getmaxtextlenstree(void);
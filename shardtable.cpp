@@ -0,0 +1,301 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  shardtable.cpp
+ *
+ *    Description:  Table of a subject-sequence consisting of shards
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 14:22:51
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+//\Ignore{
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <omp.h>
+#include "types.h"
+#include "spacedef.h"
+#include "maxmatdef.h"
+#include "distribute.h"
+
+using namespace std;
+
+//}
+
+/*EE
+  This file implements the table of a subject-sequence which is the
+  concatenation of shards, each read from its own file. In the minimizer
+  mode and in the sparse mode, a match never crosses the separator
+  between two shards. So it suffices to sample the windows and the
+  suffixes within each shard, and the samples of a shard do not depend
+  on the other shards. The sparse suffixes start at the multiples of the
+  step from the start of each shard. The samples of a shard form its
+  segment of the table: the pairs of the code of the first 
+  \texttt{wordsize} characters of a sampled suffix and its position
+  relative to the start of the shard, sorted by the codes. The segment
+  is stored in the cache file of the shard, so that it remains valid if
+  shards are added, removed, or reordered. Hence, after a change of the
+  shards, the samples are only computed, encoded and sorted for the new
+  or modified shards. The segments of all shards are then merged into
+  the buckets of the table in order of the shards, without reading the
+  subject-sequence.
+*/
+
+#define SHARDCACHESUFFIX  ".shard"
+#define SHARDCACHEMAGIC   UintConst(0x746f63697332)   // "tocis2"
+
+/*
+  The cache file of a shard begins with the following header. The
+  cache is only valid if the size and the modification time of the
+  shard file and the parameters of the sampling coincide with those
+  of the header. The header is followed by \texttt{numofsamples}
+  pairs of a code and a position relative to the start of the shard.
+*/
+
+struct Shardcacheheader
+{
+  Uint magic,             // SHARDCACHEMAGIC
+       wordsize,          // the length of the prefixes
+       window,            // the number of prefixes of a window, or 0
+       step,              // the step of the sparse suffixes, or 0
+       length,            // the length of the shard
+       filesize,          // the size of the shard file
+       filesec,           // the modification time of the shard file
+       filensec,          // the nanoseconds of the modification time
+       numofsamples;      // the number of pairs
+};
+
+/*
+  The following function sets up the header for the shard file
+  \texttt{shardfile} of the given length. If the shard file cannot
+  be inspected, then false is returned.
+*/
+
+static bool makeshardcacheheader(Shardcacheheader *header,char *shardfile,
+                                 Uint wordsize,Probeoptions *probeoptions,
+                                 Uint length)
+{
+  struct stat filestat;
+
+  if(stat(shardfile,&filestat) != 0)
+  {
+    return false;
+  }
+  memset(header,0,sizeof(Shardcacheheader));
+  header->magic = SHARDCACHEMAGIC;
+  header->wordsize = wordsize;
+  header->window = probeoptions->minimizerwindow;
+  header->step = probeoptions->sparsestep;
+  header->length = length;
+  header->filesize = (Uint) filestat.st_size;
+  header->filesec = (Uint) filestat.st_mtim.tv_sec;
+  header->filensec = (Uint) filestat.st_mtim.tv_nsec;
+  return true;
+}
+
+/*
+  The following function reads the segment of a shard from the
+  \texttt{cachefile} to \texttt{samples}, if the header of the file
+  coincides with \texttt{expected}, except for the number of samples.
+*/
+
+static bool readshardcache(char *cachefile,Shardcacheheader *expected,
+                           vector<PairUint> &samples)
+{
+  FILE *fp;
+  Shardcacheheader header;
+  bool valid = false;
+
+  fp = fopen(cachefile,"rb");
+  if(fp == NULL)
+  {
+    return false;
+  }
+  if(fread(&header,sizeof(Shardcacheheader),(size_t) 1,fp) == (size_t) 1 &&
+     header.magic == expected->magic &&
+     header.wordsize == expected->wordsize &&
+     header.window == expected->window &&
+     header.step == expected->step &&
+     header.length == expected->length &&
+     header.filesize == expected->filesize &&
+     header.filesec == expected->filesec &&
+     header.filensec == expected->filensec &&
+     header.numofsamples <= header.length)
+  {
+    samples.resize(header.numofsamples);
+    valid = (header.numofsamples == 0 ||
+             fread(samples.data(),sizeof(PairUint),
+                   (size_t) header.numofsamples,fp)
+               == (size_t) header.numofsamples);
+  }
+  (void) fclose(fp);
+  return valid;
+}
+
+/*
+  The following function writes the segment of a shard to the
+  \texttt{cachefile}. The file is first written under a temporary name
+  and then renamed, so that a concurrent run never reads an incomplete
+  cache file. A failure only leads to a warning if \texttt{verbose} is
+  true, since the segment is then computed again in the next run.
+*/
+
+static void writeshardcache(char *cachefile,Shardcacheheader *header,
+                            vector<PairUint> &samples,bool verbose)
+{
+  FILE *fp;
+  char tmpfile[PATH_MAX+64+1];
+  bool written;
+
+  sprintf(tmpfile,"%s.%lu",cachefile,(long unsigned int) getpid());
+  fp = fopen(tmpfile,"wb");
+  if(fp == NULL)
+  {
+    if(verbose)
+    {
+      fprintf(stderr,"# cannot write shard cache \"%s\"\n",cachefile);
+    }
+    return;
+  }
+  header->numofsamples = (Uint) samples.size();
+  written = (fwrite(header,sizeof(Shardcacheheader),(size_t) 1,fp)
+               == (size_t) 1 &&
+             (samples.empty() ||
+              fwrite(samples.data(),sizeof(PairUint),samples.size(),fp)
+                == samples.size()));
+  if(fclose(fp) != 0 || !written || rename(tmpfile,cachefile) != 0)
+  {
+    if(verbose)
+    {
+      fprintf(stderr,"# cannot write shard cache \"%s\"\n",cachefile);
+    }
+    (void) remove(tmpfile);
+  }
+}
+
+/*
+  The pairs of a segment are sorted by their codes and the pairs with
+  the same code by their positions.
+*/
+
+static bool bycodeandposition(const PairUint &a,const PairUint &b)
+{
+  if(a.uint0 != b.uint0)
+  {
+    return a.uint0 < b.uint0;
+  }
+  return a.uint1 < b.uint1;
+}
+
+/*
+  The following function delivers the segment of the shard of the given
+  \texttt{length} at \texttt{shard}, either from the cache file of 
+  \texttt{shardfile}, or computed from the minimizers delivered by 
+  \texttt{minimizerblocks} or from the sparse suffixes. In the latter 
+  case the cache file is written and true is returned.
+*/
+
+static bool shardsegment(Uchar *shard,Uint length,char *shardfile,
+                         Uint wordsize,Probeoptions *probeoptions,
+                         vector<PairUint> &samples,bool verbose)
+{
+  Shardcacheheader header;
+  vector< vector<Uint> > blockpositions;
+  char cachefile[PATH_MAX+sizeof(SHARDCACHESUFFIX)+1];
+  PairUint sample;
+  bool cachable;
+
+  sprintf(cachefile,"%s%s",shardfile,SHARDCACHESUFFIX);
+  cachable = makeshardcacheheader(&header,shardfile,wordsize,probeoptions,
+                                  length);
+  if(cachable && readshardcache(cachefile,&header,samples))
+  {
+    return false;
+  }
+  samples.clear();
+  if(probeoptions->sparsestep > 0)
+  {
+    for(sample.uint1 = 0; sample.uint1 + wordsize <= length;
+        sample.uint1 += probeoptions->sparsestep)
+    {
+      sample.uint0 = encoding(shard + sample.uint1,(int) wordsize);
+      samples.push_back(sample);
+    }
+  } else
+  {
+    minimizerblocks(shard,length,wordsize,probeoptions->minimizerwindow,
+                    blockpositions);
+    for(Uint block = 0; block < (Uint) blockpositions.size(); block++)
+    {
+      for(vector<Uint>::iterator p = blockpositions[block].begin();
+          p != blockpositions[block].end(); ++p)
+      {
+        sample.uint0 = encoding(shard + *p,(int) wordsize);
+        sample.uint1 = *p;
+        samples.push_back(sample);
+      }
+      vector<Uint>().swap(blockpositions[block]);
+    }
+  }
+  sort(samples.begin(),samples.end(),bycodeandposition);
+  if(cachable)
+  {
+    writeshardcache(cachefile,&header,samples,verbose);
+  }
+  return true;
+}
+
+/*EE
+  The following function fills the table with the samples of the
+  \texttt{numofshards} shards of \texttt{text}, where shard \(i\)
+  starts at \texttt{shardstart[i]} and ends before
+  \texttt{shardstart[i+1]}\(-1\). In the minimizer mode, the minimizers
+  of the windows within each shard are stored, and in the sparse mode,
+  the suffixes starting at the multiples of the step from the start of
+  each shard, followed by at least \texttt{wordsize} characters of the
+  shard. If \texttt{verbose} is true, then the number of shards whose
+  segments were not taken from their cache files is shown.
+*/
+
+void fillShardedTable(Uchar *text, Table& table, Uint wordsize, Probeoptions *probeoptions, char **shardfilelist, Uint numofshards, Uint *shardstart, bool verbose)
+{
+  vector< vector<PairUint> > shardsamples(numofshards);
+  Uint shard, computed = 0;
+
+  for(shard = 0; shard < numofshards; shard++)
+  {
+    Uint start = shardstart[shard],
+         length = shardstart[shard+1] - 1 - start;
+
+    if(shardsegment(text + start,length,shardfilelist[shard],wordsize,
+                    probeoptions,shardsamples[shard],verbose))
+    {
+      computed++;
+    }
+    for(vector<PairUint>::iterator p = shardsamples[shard].begin();
+        p != shardsamples[shard].end(); ++p)
+    {
+      p->uint1 += start;
+    }
+  }
+  if(verbose)
+  {
+    fprintf(stderr,"# segments of %lu of %lu shards computed\n",
+            (long unsigned int) computed,(long unsigned int) numofshards);
+  }
+  fillCodedTable(table,wordsize,shardsamples);
+}
@@ -13,8 +13,11 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <cstring>
 #include <string>
+#include <atomic>
+#include <omp.h>
 //#include <mpi.h>
 #include "types.h"
 #include "errordef.h"
@@ -42,6 +45,14 @@ using namespace std;
   The function \texttt{dynamicstrdup} should be called
   via the macro \texttt{DYNAMICSTRDUP}.
   \end{enumerate}
+  The functions can be called from several threads at the same time.
+  The memory itself is obtained from \texttt{malloc} and \texttt{realloc}
+  (or \texttt{mmap} for reserved blocks). Each thread describes the
+  blocks it allocates in its own block table, protected by its own lock.
+  Thus a thread only competes with other threads when it enlarges or
+  frees a block allocated by another thread. The number of bytes
+  currently allocated and its peak are maintained per block table, and
+  they are only summed up on demand.
 */
 
 /*EE
@@ -55,21 +66,57 @@ using namespace std;
                        (Sint) number,M);\
         exit(EXIT_FAILURE)
 
+/*
+  The number of slots per chunk of the list of block tables.
+*/
+
+#define SPACEBLOCKTABLECHUNK 64
+
 struct Blockdescription
 {
   void *spaceptr;      // ptr to the spaceblock
   Uint sizeofcells,    // size of cells of the block
        numberofcells;  // number of cells in the block
   char *fileallocated; // the filenames where the block was allocated
-  Uint lineallocated;  // the linenumber where the
+  Uint lineallocated,  // the linenumber where the
+       reservedcells;  // number of cells of reserved address space,
+                       // 0 if the block was obtained via \texttt{realloc}
 };
 
-/*@null@*/ static Blockdescription *blocks = NULL;
+struct Spaceblocktable
+{
+  /*@null@*/ Blockdescription *blocks;
+  Uint numberofblocks, // numberofblocks
+       nextfreeblock;  // index of next free block
+  omp_lock_t lock;     // protects the components above and the updates of
+                       // the following counters
+  atomic<Uint> currentspace, // currently allocated num of bytes of these
+                             // blocks, read by other threads without the lock
+               spacepeak;    // maximum of currentspace
 
-static Uint numberofblocks = 0, // numberofblocks
-            nextfreeblock = 0,  // index of next free block
-            currentspace = 0,   // currently allocated num of bytes
-            spacepeak = 0;      // maximally allocated num of bytes
+};
+
+/*
+  The block tables are referred to by a list of chunks of slots, which
+  is extended by a new chunk whenever more threads allocate space than
+  there are slots. 
+  A chunk is never freed, so that other threads can walk the list 
+  without a lock. A slot is \texttt{NULL} until the block table of the 
+  thread having reserved it is stored with release semantics, and
+  it is read with acquire semantics.
+*/
+
+struct Spaceblocktablechunk
+{
+  atomic<Spaceblocktable *> tables[SPACEBLOCKTABLECHUNK];
+  atomic<Spaceblocktablechunk *> next;
+};
+
+static Spaceblocktablechunk firstblocktablechunk;
+static atomic<Uint> numofblocktables(0);
+static __thread Spaceblocktable *localblocktable = NULL;
+
+static atomic<bool> maxspaceset(false);
 
 /*
   The following two tables store important information to
@@ -114,99 +161,335 @@ static void setmaxspace(void)
 
 /*
   The following two functions \texttt{addspace} and \texttt{subtractspace} 
-  maintain the variables \texttt{currentspace} and \texttt{spacepeak}.
+  maintain the counter and the peak of the block table. No counter shared
+  by all threads is touched. The caller holds the lock of the block table.
 */
 
-static void addspace(Uint space)
+static void addspace(Spaceblocktable *blocktable,Uint space)
 {
-  if(currentspace == 0)
+  Uint current;
+
+  if(!maxspaceset.load(memory_order_relaxed) && !maxspaceset.exchange(true))
   {
     setmaxspace();
-    currentspace = space;
-  } else
+  }
+  current = blocktable->currentspace.load(memory_order_relaxed) + space;
+  blocktable->currentspace.store(current,memory_order_relaxed);
+  if(current > blocktable->spacepeak.load(memory_order_relaxed))
   {
-    currentspace += space;
+    blocktable->spacepeak.store(current,memory_order_relaxed);
   }
-  if(currentspace > spacepeak)
+}
+
+static void subtractspace(Spaceblocktable *blocktable,Uint space)
+{
+  blocktable->currentspace.store(
+    blocktable->currentspace.load(memory_order_relaxed) - space,
+    memory_order_relaxed);
+}
+
+/*
+  The following function delivers the slot for block table \texttt{tablenum}.
+  If its chunk does not exist, then it is appended to the list if
+  \texttt{extend} is true, and otherwise \texttt{NULL} is returned.
+*/
+
+static atomic<Spaceblocktable *> *blocktableslot(Uint tablenum,bool extend)
+{
+  Spaceblocktablechunk *chunk = &firstblocktablechunk, *next, *newchunk;
+  Uint i;
+
+  while(tablenum >= (Uint) SPACEBLOCKTABLECHUNK)
   {
-    spacepeak = currentspace;
+    next = chunk->next.load(memory_order_acquire);
+    if(next == NULL)
+    {
+      if(!extend)
+      {
+        return NULL;
+      }
+      newchunk = (Spaceblocktablechunk *) malloc(sizeof(Spaceblocktablechunk));
+      if(newchunk == NULL)
+      {
+        fprintf(stderr,"not enough space for the block tables available\n");
+        exit(EXIT_FAILURE);
+      }
+      for(i=0; i < (Uint) SPACEBLOCKTABLECHUNK; i++)
+      {
+        newchunk->tables[i].store(NULL,memory_order_relaxed);
+      }
+      newchunk->next.store(NULL,memory_order_relaxed);
+      if(chunk->next.compare_exchange_strong(next,newchunk,
+                                             memory_order_acq_rel,
+                                             memory_order_acquire))
+      {
+        next = newchunk;
+      } else
+      {
+        free(newchunk);  // another thread appended a chunk, now in next
+      }
+    }
+    chunk = next;
+    tablenum -= SPACEBLOCKTABLECHUNK;
   }
+  return &chunk->tables[tablenum];
 }
 
-static void subtractspace(Uint space)
+/*
+  The following function delivers block table \texttt{tablenum}, or 
+  \texttt{NULL} if the thread having reserved it has not yet stored it.
+*/
+
+static Spaceblocktable *getblocktable(Uint tablenum)
 {
-  currentspace -= space;
+  atomic<Spaceblocktable *> *slot = blocktableslot(tablenum,false);
+
+  return (slot == NULL) ? NULL : slot->load(memory_order_acquire);
+}
+
+/*
+  The following function delivers the block table of the calling thread. 
+  It is created when the thread allocates space for the first time.
+*/
+
+static Spaceblocktable *getlocalblocktable(void)
+{
+  Uint tablenum;
+
+  if(localblocktable == NULL)
+  {
+    localblocktable = (Spaceblocktable *) calloc((size_t) 1,
+                                                 sizeof(Spaceblocktable));
+    if(localblocktable == NULL)
+    {
+      fprintf(stderr,"not enough space for the block table available\n");
+      exit(EXIT_FAILURE);
+    }
+    omp_init_lock(&localblocktable->lock);
+    tablenum = numofblocktables.fetch_add(1);
+    blocktableslot(tablenum,true)->store(localblocktable,memory_order_release);
+  }
+  return localblocktable;
+}
+
+/*
+  The following function delivers the number of the block for \texttt{ptr}
+  in \texttt{blocktable}, or \texttt{nextfreeblock} if there is none.
+*/
+
+static Uint searchblock(Spaceblocktable *blocktable,void *ptr)
+{
+  Uint blocknum;
+
+  for(blocknum=0; blocknum < blocktable->nextfreeblock; blocknum++)
+  {
+    if(blocktable->blocks[blocknum].spaceptr == ptr)
+    {
+      break;
+    }
+  }
+  return blocknum;
+}
+
+/*
+  The following function delivers the block table containing the block for 
+  \texttt{ptr} and stores the number of the block in \texttt{blocknum}. 
+  The block table of the calling thread is searched first. The lock of the 
+  block table delivered is set. If there is no block for \texttt{ptr}, then 
+  \texttt{NULL} is returned.
+*/
+
+static Spaceblocktable *findblocktable(void *ptr,Uint *blocknum)
+{
+  Spaceblocktable *blocktable = getlocalblocktable();
+  Uint tablenum, numoftablesnow;
+
+  omp_set_lock(&blocktable->lock);
+  if((*blocknum = searchblock(blocktable,ptr)) < blocktable->nextfreeblock)
+  {
+    return blocktable;
+  }
+  omp_unset_lock(&blocktable->lock);
+  numoftablesnow = numofblocktables.load();
+  for(tablenum = 0; tablenum < numoftablesnow; tablenum++)
+  {
+    blocktable = getblocktable(tablenum);
+    if(blocktable == NULL || blocktable == localblocktable)
+    {
+      continue;
+    }
+    omp_set_lock(&blocktable->lock);
+    if((*blocknum = searchblock(blocktable,ptr)) < blocktable->nextfreeblock)
+    {
+      return blocktable;
+    }
+    omp_unset_lock(&blocktable->lock);
+  }
+  return NULL;
+}
+
+/*
+  The following function delivers the number of the next free block of
+  \texttt{blocktable}. The table of blocks is enlarged if necessary.
+  The caller holds the lock of the block table.
+*/
+
+static Uint freeblocknum(Spaceblocktable *blocktable,Uint line,Uint size,
+                         Uint number)
+{
+  Uint i, blocknum;
+
+  blocknum = searchblock(blocktable,NULL);
+  if(blocknum == blocktable->nextfreeblock)
+  {
+    blocktable->nextfreeblock += 64;
+    blocktable->blocks 
+      = (Blockdescription *) realloc(blocktable->blocks,
+                                     (size_t) (sizeof(Blockdescription)* 
+                                               blocktable->nextfreeblock));
+    if(blocktable->blocks == NULL)
+    {
+      ALLOCVIAFATAL("not enough space for the block descriptions available");
+    }
+    for(i=blocknum; i < blocktable->nextfreeblock; i++)
+    {
+      blocktable->blocks[i].spaceptr = NULL;
+      blocktable->blocks[i].sizeofcells = 0;
+      blocktable->blocks[i].numberofcells = 0;
+      blocktable->blocks[i].reservedcells = 0;
+    }
+  }
+  NOTSUPPOSEDTOBENULL(blocktable->blocks);
+  return blocknum;
 }
 
 /*EE
   The following function allocates \texttt{number} cells of \texttt{size}
   for a given pointer \texttt{ptr}. If this is \texttt{NULL}, then the next 
-  free block is used. Otherwise, we look for the block number corresponding 
-  to \texttt{ptr}. If there is none, then the program exits with exit code 1. 
+  free block of the block table of the calling thread is used. Otherwise, we 
+  look for the block number corresponding to \texttt{ptr}. If there is 
+  none, then the program exits with exit code 1. 
+  If \texttt{ptr} refers to a block obtained by \texttt{reservespaceviaptr},
+  then the block is never moved: the first \texttt{number} cells of the
+  reserved address space are declared to be in use, and \texttt{ptr}
+  is returned.
 */
 
 /*@notnull@*/ void *allocandusespaceviaptr(char *file,Uint line, 
                                            /*@null@*/ void *ptr,
                                            Uint size,Uint number)
 {
-  Uint i, blocknum;
+  Uint blocknum;
+  Spaceblocktable *blocktable;
+  Blockdescription *block;
+  void *spaceptr;
 
-  if(nextfreeblock > 0)
+  if(ptr == NULL)
   {
-    NOTSUPPOSEDTOBENULL(blocks);
-    for(blocknum=0; blocknum < nextfreeblock; blocknum++)
-    {
-      if(blocks[blocknum].spaceptr == ptr)
-      {
-        break;
-      }
-    }
+    blocktable = getlocalblocktable();
+    omp_set_lock(&blocktable->lock);
+    blocknum = freeblocknum(blocktable,line,size,number);
   } else
   {
-    blocknum = 0;
-  }
-  if(blocknum == nextfreeblock)
-  {
-    if(ptr == NULL)
-    {
-      nextfreeblock += 64;
-      blocks = (Blockdescription *) realloc(blocks,
-                                            (size_t) (sizeof(Blockdescription)* 
-                                                      nextfreeblock));
-      if(blocks == NULL)
-      {
-        ALLOCVIAFATAL("not enough space for the block descriptions available");
-      }
-      for(i=blocknum; i < nextfreeblock; i++)
-      {
-        blocks[i].spaceptr = NULL;
-        blocks[i].sizeofcells = 0;
-        blocks[i].numberofcells = 0;
-      }
-    } else
+    if((blocktable = findblocktable(ptr,&blocknum)) == NULL)
     {
       ALLOCVIAFATAL("cannot find space block");
     }
   }
-  NOTSUPPOSEDTOBENULL(blocks);
-  subtractspace(blocks[blocknum].numberofcells * blocks[blocknum].sizeofcells);
-  addspace(size*number);
-  blocks[blocknum].numberofcells = number;
-  blocks[blocknum].sizeofcells = size;
-  blocks[blocknum].fileallocated = file;
-  blocks[blocknum].lineallocated = line;
-  if(blocks[blocknum].spaceptr == NULL)
+  block = blocktable->blocks + blocknum;
+  if(block->reservedcells > 0 &&
+     size * number > block->sizeofcells * block->reservedcells)
   {
-    numberofblocks++;
+    ALLOCVIAFATAL("reserved address space exhausted");
   }
-  if((blocks[blocknum].spaceptr 
-      = realloc(blocks[blocknum].spaceptr,(size_t) (size*number))) == NULL)
+  subtractspace(blocktable,block->numberofcells * block->sizeofcells);
+  addspace(blocktable,size*number);
+  if(block->reservedcells > 0)
+  {
+    block->reservedcells = (block->sizeofcells * block->reservedcells)/size;
+  }
+  block->numberofcells = number;
+  block->sizeofcells = size;
+  block->fileallocated = file;
+  block->lineallocated = line;
+  if(block->spaceptr == NULL)
+  {
+    blocktable->numberofblocks++;
+  }
+  if(block->reservedcells == 0 &&
+     (block->spaceptr = realloc(block->spaceptr,(size_t) (size*number))) 
+     == NULL)
   {
     ALLOCVIAFATAL("not enough memory");
   }
+  if(block->reservedcells == 0 && size * number >= HUGEPAGESIZE)
+  {
+    applymempolicy(block->spaceptr,size*number);
+  }
+  spaceptr = block->spaceptr;
+  omp_unset_lock(&blocktable->lock);
+
+  NOTSUPPOSEDTOBENULL(spaceptr);
+  return spaceptr;
+}
+
+/*EE
+  The following function reserves address space for \texttt{number} 
+  cells of \texttt{size} bytes, without committing any memory. The
+  pages are only backed by physical memory when they are touched for
+  the first time. The block initially contains 0 cells in use, and it
+  can be enlarged via \texttt{allocandusespaceviaptr} up to 
+  \texttt{number} cells without being moved. If the address space
+  cannot be reserved, then \texttt{NULL} is returned. In this case
+  the caller can fall back to an ordinary allocation by calling
+  \texttt{allocandusespaceviaptr} with a \texttt{NULL} pointer.
+*/
+
+/*@null@*/ void *reservespaceviaptr(char *file,Uint line,Uint size,Uint number)
+{
+  Uint blocknum;
+  Spaceblocktable *blocktable;
+  void *spaceptr;
+
+  if(size * number == 0)
+  {
+    return NULL;
+  }
+  spaceptr = mmap(NULL,(size_t) (size*number),PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,(off_t) 0);
+  if(spaceptr == MAP_FAILED)
+  {
+    return NULL;
+  }
+  applymempolicy(spaceptr,size*number);
+  blocktable = getlocalblocktable();
+  omp_set_lock(&blocktable->lock);
+  blocknum = freeblocknum(blocktable,line,size,number);
+  blocktable->blocks[blocknum].spaceptr = spaceptr;
+  blocktable->blocks[blocknum].sizeofcells = size;
+  blocktable->blocks[blocknum].numberofcells = 0;
+  blocktable->blocks[blocknum].reservedcells = number;
+  blocktable->blocks[blocknum].fileallocated = file;
+  blocktable->blocks[blocknum].lineallocated = line;
+  blocktable->numberofblocks++;
+  omp_unset_lock(&blocktable->lock);
+  return spaceptr;
+}
 
-  NOTSUPPOSEDTOBENULL(blocks[blocknum].spaceptr);
-  return blocks[blocknum].spaceptr;
+/*
+  The following function releases the memory of \texttt{block}.
+*/
+
+static void releaseblock(Blockdescription *block)
+{
+  if(block->reservedcells > 0)
+  {
+    (void) munmap(block->spaceptr,
+                  (size_t) (block->sizeofcells * block->reservedcells));
+  } else
+  {
+    free(block->spaceptr);
+  }
 }
 
 /*EE
@@ -235,6 +518,8 @@ static void subtractspace(Uint space)
 void freespaceviaptr(char *file,Uint line,void *ptr)
 {
   Uint blocknum;
+  Spaceblocktable *blocktable;
+  Blockdescription *block;
 
   if(ptr == NULL)
   {
@@ -243,60 +528,66 @@ void freespaceviaptr(char *file,Uint line,void *ptr)
     //MPI_Finalize();
     exit(EXIT_SUCCESS);
   }
-  NOTSUPPOSEDTOBENULL(blocks);
-  for(blocknum=0; blocknum < nextfreeblock; blocknum++)
-  {
-    if(blocks[blocknum].spaceptr == ptr)
-    {
-      break;
-    }
-  }
-  if(blocknum == nextfreeblock)
+  if((blocktable = findblocktable(ptr,&blocknum)) == NULL)
   {
     fprintf(stderr,"freespaceviaptr(file=%s,line=%lu): cannot find space block\n", file,(Uint) line);
     //MPI_Finalize();
     //exit(EXIT_FAILURE);
+    return;
   }
-  free(blocks[blocknum].spaceptr);
-  subtractspace(blocks[blocknum].numberofcells * blocks[blocknum].sizeofcells);
-  blocks[blocknum].numberofcells = 0;
-  blocks[blocknum].sizeofcells = 0;
-  blocks[blocknum].fileallocated = NULL;
-  blocks[blocknum].lineallocated = 0;
-  blocks[blocknum].spaceptr = NULL;
-  if(numberofblocks == 0)
+  block = blocktable->blocks + blocknum;
+  releaseblock(block);
+  subtractspace(blocktable,block->numberofcells * block->sizeofcells);
+  block->numberofcells = 0;
+  block->sizeofcells = 0;
+  block->reservedcells = 0;
+  block->fileallocated = NULL;
+  block->lineallocated = 0;
+  block->spaceptr = NULL;
+  if(blocktable->numberofblocks == 0)
   {
     NOTSUPPOSED;
   }
-  numberofblocks--;
+  blocktable->numberofblocks--;
+  omp_unset_lock(&blocktable->lock);
 }
 
 //\IgnoreLatex{
 
 /*EE
   The following function frees the space for all main memory blocks
-  which have not already been freed.
+  which have not already been freed. It must not be called while other
+  threads allocate space.
 */
 
 void wrapspace(void)
 {
-  Uint blocknum;
+  Uint tablenum, blocknum;
+  Spaceblocktable *blocktable;
+  Blockdescription *block;
 
-
-  NOTSUPPOSEDTOBENULL(blocks);
-  for(blocknum=0; blocknum < nextfreeblock; blocknum++)
+  for(tablenum=0; tablenum < numofblocktables.load(); tablenum++)
   {
-    if(blocks[blocknum].spaceptr != NULL)
+    if((blocktable = getblocktable(tablenum)) == NULL)
     {
-      free(blocks[blocknum].spaceptr);
-      blocks[blocknum].spaceptr = NULL;
+      continue;
     }
-    subtractspace(blocks[blocknum].sizeofcells * 
-                  blocks[blocknum].numberofcells);
-    blocks[blocknum].sizeofcells = 0;
-    blocks[blocknum].numberofcells = 0;
-    blocks[blocknum].fileallocated = NULL;
-    blocks[blocknum].lineallocated = 0;
+    for(blocknum=0; blocknum < blocktable->nextfreeblock; blocknum++)
+    {
+      block = blocktable->blocks + blocknum;
+      if(block->spaceptr != NULL)
+      {
+        releaseblock(block);
+        block->spaceptr = NULL;
+      }
+      subtractspace(blocktable,block->sizeofcells * block->numberofcells);
+      block->sizeofcells = 0;
+      block->numberofcells = 0;
+      block->reservedcells = 0;
+      block->fileallocated = NULL;
+      block->lineallocated = 0;
+    }
+    blocktable->numberofblocks = 0;
   }
 }
 
@@ -311,17 +602,25 @@ void wrapspace(void)
 
 void activeblocks(void)
 {
-  Uint blocknum;
+  Uint tablenum, blocknum;
+  Spaceblocktable *blocktable;
 
-  NOTSUPPOSEDTOBENULL(blocks);
-  for(blocknum=0; blocknum < nextfreeblock; blocknum++)
+  for(tablenum=0; tablenum < numofblocktables.load(); tablenum++)
   {
-    if(blocks[blocknum].spaceptr != NULL)
+    if((blocktable = getblocktable(tablenum)) == NULL)
     {
-      fprintf(stderr,"# active block %lu: ",(Sint) blocknum);
-      fprintf(stderr,"allocated in file \"%s\", line %lu\n",
-              blocks[blocknum].fileallocated,
-              (Sint) blocks[blocknum].lineallocated);
+      continue;
+    }
+    for(blocknum=0; blocknum < blocktable->nextfreeblock; blocknum++)
+    {
+      if(blocktable->blocks[blocknum].spaceptr != NULL)
+      {
+        fprintf(stderr,"# active block %lu of block table %lu: ",
+                (Sint) blocknum,(Sint) tablenum);
+        fprintf(stderr,"allocated in file \"%s\", line %lu\n",
+                blocktable->blocks[blocknum].fileallocated,
+                (Sint) blocktable->blocks[blocknum].lineallocated);
+      }
     }
   }
 }
@@ -336,51 +635,94 @@ void activeblocks(void)
 
 void checkspaceleak(void)
 {
-  Uint blocknum;
+  Uint tablenum, blocknum;
+  Spaceblocktable *blocktable;
+  Blockdescription *block;
 
-  for(blocknum=0; blocknum < nextfreeblock; blocknum++)
+  for(tablenum=0; tablenum < numofblocktables.load(); tablenum++)
   {
-    if(blocks[blocknum].spaceptr != NULL)
+    if((blocktable = getblocktable(tablenum)) == NULL)
     {
-      fprintf(stderr,"space leak: main memory for block %lu not freed\n",
-              (Sint) blocknum);
-      fprintf(stderr,"%lu cells of size %lu\n",
-              (Sint) blocks[blocknum].numberofcells,
-              (Sint) blocks[blocknum].sizeofcells);
-      fprintf(stderr,"allocated: ");
-      if(blocks[blocknum].fileallocated == NULL)
-      {
-        fprintf(stderr,"cannot identify\n");
-      } else
+      continue;
+    }
+    for(blocknum=0; blocknum < blocktable->nextfreeblock; blocknum++)
+    {
+      block = blocktable->blocks + blocknum;
+      if(block->spaceptr != NULL)
       {
-        fprintf(stderr,"file \"%s\", line %lu\n",
-               blocks[blocknum].fileallocated,
-               (Sint) blocks[blocknum].lineallocated);
+        fprintf(stderr,"space leak: main memory for block %lu not freed\n",
+                (Sint) blocknum);
+        fprintf(stderr,"%lu cells of size %lu\n",
+                (Sint) block->numberofcells,
+                (Sint) block->sizeofcells);
+        fprintf(stderr,"allocated: ");
+        if(block->fileallocated == NULL)
+        {
+          fprintf(stderr,"cannot identify\n");
+        } else
+        {
+          fprintf(stderr,"file \"%s\", line %lu\n",
+                 block->fileallocated,
+                 (Sint) block->lineallocated);
+        }
+        //MPI_Finalize();
+        exit(EXIT_FAILURE);
       }
+    }
+    if(blocktable->numberofblocks > 0)
+    {
+      fprintf(stderr,"space leak: number of blocks = %u\n",
+              (unsigned int) blocktable->numberofblocks);
       //MPI_Finalize();
       exit(EXIT_FAILURE);
-    }
+    } 
+    free(blocktable->blocks);
+    blocktable->blocks = NULL;
+    blocktable->nextfreeblock = 0;
+    blocktable->currentspace.store(0,memory_order_relaxed);
+    blocktable->spacepeak.store(0,memory_order_relaxed);
   }
-  if(numberofblocks > 0)
+}
+
+/*EE
+  The following function returns the number of bytes currently allocated,
+  obtained by summing up the counters of all block tables. The result is only
+  exact if no other thread allocates space at the same time.
+*/
+
+Uint getcurrentspace(void)
+{
+  Uint tablenum, sum = 0;
+  Spaceblocktable *blocktable;
+
+  for(tablenum=0; tablenum < numofblocktables.load(); tablenum++)
   {
-    fprintf(stderr,"space leak: number of blocks = %u\n",(unsigned int) numberofblocks);
-    //MPI_Finalize();
-    exit(EXIT_FAILURE);
-  } 
-  free(blocks);
-  blocks = NULL;
-  numberofblocks = 0;
-  nextfreeblock = 0;
-  currentspace = 0;
-  spacepeak = 0;
+    if((blocktable = getblocktable(tablenum)) != NULL)
+    {
+      sum += blocktable->currentspace.load(memory_order_relaxed);
+    }
+  }
+  return sum;
 }
 
 /*EE
-  The following function returns the space peak in bytes.
+  The following function returns the space peak in bytes, obtained by
+  summing up the peaks of all block tables. If only one thread allocates
+  space, this is the exact peak. Otherwise it is an upper bound, since
+  the block tables may have reached their peaks at different times.
 */
 
 Uint getspacepeak(void)
 {
-  return spacepeak;
-}
+  Uint tablenum, sum = 0;
+  Spaceblocktable *blocktable;
 
+  for(tablenum=0; tablenum < numofblocktables.load(); tablenum++)
+  {
+    if((blocktable = getblocktable(tablenum)) != NULL)
+    {
+      sum += blocktable->spacepeak.load(memory_order_relaxed);
+    }
+  }
+  return sum;
+}
@@ -21,6 +21,8 @@
 /*@notnull@*/ void *allocandusespaceviaptr(char *file,Uint line,
                                            /*@null@*/ void *ptr,
                                            Uint size,Uint number);
+/*@null@*/ void *reservespaceviaptr(char *file,Uint line,Uint size,
+                                    Uint number);
 /*@notnull@*/ char *dynamicstrdup(char *file,Uint line,char *source);
 void freespaceviaptr(char *file,Uint line,void *ptr);
 /*@null@*/ void *creatememorymapforfiledesc(char *file,Uint line,Sint fd,
@@ -42,6 +44,8 @@ Sint deletememorymap(char *file,Uint line,void *mappedfile);
   \item
   \texttt{allocandusespaceviaptr}, 
   \item
+  \texttt{reservespaceviaptr}, 
+  \item
   \texttt{freespaceviaptr},
   \item
   \texttt{dynamicstrdup}, 
@@ -71,6 +75,17 @@ Sint deletememorymap(char *file,Uint line,void *mappedfile);
         (T *) allocandusespaceviaptr(__FILE__,(Uint) __LINE__,\
                                      S,(Uint) sizeof(T),N)
 
+/*
+  The macro \texttt{RESERVESPACE} reserves address space for \texttt{N}
+  elements of type \texttt{T}, without committing memory. The result
+  is \texttt{NULL} if the space cannot be reserved. Otherwise the
+  block can be grown via \texttt{ALLOCSPACE} up to \texttt{N} elements,
+  without ever being moved.
+*/
+
+#define RESERVESPACE(T,N)\
+        (T *) reservespaceviaptr(__FILE__,(Uint) __LINE__,(Uint) sizeof(T),N)
+
 /*
   The macro \texttt{FREESPACE} frees the space pointed to by \texttt{P},
   if this is not \texttt{NULL}. It also sets the 
@@ -32,6 +32,7 @@ Sint depthfirststree(Suffixtree *stree,Reference *startnode,
                      bool (*processbranch1)(Bref,void *),
                      Sint (*processbranch2)(Bref,void *),
                      bool (*stoptraversal)(void *),void *stopinfo,void *info);
+void computeleafcounts(Suffixtree *stree);
 Uchar *findprefixpathstree(Suffixtree *stree,
                                        ArrayPathinfo *path,
                                        Location *outloc,
@@ -0,0 +1,352 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  streedfs.h
+ *
+ *    Description:  Inlined depth first traversal of the suffix tree
+ *
+ *        Version:  1.0
+ *        Created:  19/10/26 14:02:17
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Julio Cesar Garcia Vizcaino (garviz), garviz@garviz.mx
+ *        Company:
+ *
+ * =====================================================================================
+ */
+#ifndef STREEDFS_H
+#define STREEDFS_H
+#include <vector>
+#include <omp.h>
+#include "types.h"
+#include "arraydef.h"
+#include "streetyp.h"
+#include "streemac.h"
+#include "streeacc.h"
+
+/*
+  This file contains a variant of \texttt{depthfirststree} which is a
+  template over the three functions applied during the traversal. Each
+  of them can be any callable, in particular a class with an
+  \texttt{operator()}, so that the calls are inlined into the traversal.
+  \begin{itemize}
+  \item
+  \texttt{processleaf(leafindex,lcpnode)} is applied to each leaf. It
+  returns 0 if the traversal is to be continued.
+  \item
+  \texttt{processbranch1(nodeptr)} is applied to each branching node when
+  it is visited for the first time. If it returns \texttt{false}, then
+  the subtree below the node is skipped.
+  \item
+  \texttt{processbranch2(nodeptr)} is applied to each branching node when
+  its subtree has been processed. It returns 0 if the traversal is to
+  be continued.
+  \end{itemize}
+  The start node itself is neither passed to \texttt{processbranch1} nor
+  to \texttt{processbranch2}. The stack of the branching nodes on the path
+  from the start node is supplied by the caller, so that its space can be
+  reused for many traversals. Entries already on the stack are not touched.
+  Whenever a function is applied, the top of the stack is the father of
+  the current node. The traversal returns 0, or a negative value if one
+  of the functions reported an error.
+*/
+
+/*
+  The following function sets \texttt{ref} to the leaf or branching
+  node referred to by \texttt{value}.
+*/
+
+static inline void setdfsreference(Suffixtree *stree,Reference *ref,Uint value)
+{
+  if(ISLEAF(value))
+  {
+    ref->address = stree->leaftab + GETLEAFINDEX(value);
+    ref->toleaf = true;
+  } else
+  {
+    ref->address = stree->branchtab + GETBRANCHINDEX(value);
+    ref->toleaf = false;
+  }
+}
+
+/*
+  The following functions do nothing. They can be supplied to
+  \texttt{depthfirsttraversal} if branching nodes need not be processed.
+*/
+
+struct Dfsgodown
+{
+  bool operator()(/*@unused@*/ Bref nodeptr) const
+  {
+    return true;
+  }
+};
+
+struct Dfsnothing
+{
+  Sint operator()(/*@unused@*/ Bref nodeptr) const
+  {
+    return 0;
+  }
+};
+
+template<typename Processleaf,typename Processbranch1,typename Processbranch2>
+Sint depthfirsttraversal(Suffixtree *stree,Reference *startnode,
+                         ArrayBref *stack,Processleaf processleaf,
+                         Processbranch1 processbranch1,
+                         Processbranch2 processbranch2)
+{
+  bool readyforpop = false;
+  Uint brotherval, stackbottom;
+  Bref lcpnode = NULL;
+  Reference currentnode;
+
+  if(startnode->toleaf)
+  {
+    if(processleaf(LEAFADDR2NUM(stree,startnode->address),lcpnode) != 0)
+    {
+      return -1;
+    }
+    return 0;
+  }
+  stackbottom = stack->nextfreeBref;
+  STOREINARRAY(stack,Bref,128,startnode->address);
+  setdfsreference(stree,&currentnode,GETCHILD(startnode->address));
+  while(true)
+  {
+    if(currentnode.toleaf)
+    {
+      if(processleaf(LEAFADDR2NUM(stree,currentnode.address),lcpnode) != 0)
+      {
+        stack->nextfreeBref = stackbottom;
+        return -1;
+      }
+      brotherval = LEAFBROTHERVAL(*(currentnode.address));
+      if(NILPTR(brotherval))
+      {
+        readyforpop = true;
+        currentnode.toleaf = false;
+      } else
+      {
+        setdfsreference(stree,&currentnode,brotherval);
+        lcpnode = stack->spaceBref[stack->nextfreeBref-1];
+      }
+    } else
+    {
+      if(readyforpop)
+      {
+        if(stack->nextfreeBref == stackbottom + 1)
+        {
+          break;
+        }
+        stack->nextfreeBref--;
+        if(processbranch2(stack->spaceBref[stack->nextfreeBref]) != 0)
+        {
+          stack->nextfreeBref = stackbottom;
+          return -2;
+        }
+        brotherval = GETBROTHER(stack->spaceBref[stack->nextfreeBref]);
+        if(!NILPTR(brotherval))
+        {
+          setdfsreference(stree,&currentnode,brotherval);
+          lcpnode = stack->spaceBref[stack->nextfreeBref-1];
+          readyforpop = false;
+        }
+      } else
+      {
+        if(processbranch1(currentnode.address))
+        {
+          STOREINARRAY(stack,Bref,128,currentnode.address);
+          setdfsreference(stree,&currentnode,GETCHILD(currentnode.address));
+        } else
+        {
+          brotherval = GETBROTHER(currentnode.address);
+          if(NILPTR(brotherval))
+          {
+            readyforpop = true;
+          } else
+          {
+            setdfsreference(stree,&currentnode,brotherval);
+          }
+        }
+      }
+    }
+  }
+  stack->nextfreeBref = stackbottom;
+  return 0;
+}
+
+/*
+  The following functions implement a parallel enumeration of the leaves
+  below some node. The subtree is split into tasks at branching nodes, and
+  the tasks are distributed over the threads by the OpenMP task scheduler,
+  which lets idle threads steal pending tasks. Since subtree sizes are
+  very skewed in repetitive sequences, a task is only split off at a
+  node whose father has at least two branching children: a chain of
+  nodes with only one branching child each, as caused by a long repeat,
+  is traversed by a single task without using up the nesting levels.
+  At most \texttt{maxlevel} tasks are nested.
+
+  For each leaf, the callable \texttt{makeitem(leafindex,father,item)}
+  is applied, where \texttt{father} is the father of the leaf. If it
+  returns \texttt{true}, then \texttt{item} is kept. Finally, the callable
+  \texttt{consumeitem(item)} is applied to all items in the order of
+  their leaves in a sequential depth first traversal, i.e.\ in
+  lexicographic order of the suffixes.
+*/
+
+template<typename Item>
+struct Subtreeresult
+{
+  std::vector<Item> items;          // items of the leaves visited by the task
+  std::vector<Uint> splitpoints;    // number of items before each subtask
+  std::vector<Subtreeresult<Item> *> subtasks; // results of the subtasks
+};
+
+/*
+  The following function delivers the number of branching children
+  of the branching node \texttt{nodeptr}, but counts at most to 2.
+*/
+
+static inline Uint branchingchildren(Suffixtree *stree,Bref nodeptr)
+{
+  Uint child, count = 0;
+
+  for(child = GETCHILD(nodeptr); !NILPTR(child); 
+      child = ISLEAF(child) ? LEAFBROTHERVAL(stree->leaftab[GETLEAFINDEX(child)])
+                            : GETBROTHER(stree->branchtab + 
+                                         GETBRANCHINDEX(child)))
+  {
+    if(!ISLEAF(child) && ++count == UintConst(2))
+    {
+      break;
+    }
+  }
+  return count;
+}
+
+template<typename Item,typename Makeitem>
+static void subtreetask(Suffixtree *stree,Reference startnode,Uint level,
+                        Uint maxlevel,Makeitem makeitem,
+                        Subtreeresult<Item> *result);
+
+template<typename Item,typename Makeitem>
+struct Subtreeleaf
+{
+  ArrayBref *stack;
+  Makeitem *makeitem;
+  Subtreeresult<Item> *result;
+  Sint operator()(Uint leafindex,/*@unused@*/ Bref lcpnode) const
+  {
+    Item item;
+    Bref father = (stack->nextfreeBref > 0) 
+                    ? stack->spaceBref[stack->nextfreeBref-1] : NULL;
+
+    if((*makeitem)(leafindex,father,&item))
+    {
+      result->items.push_back(item);
+    }
+    return 0;
+  }
+};
+
+template<typename Item,typename Makeitem>
+struct Subtreesplit
+{
+  Suffixtree *stree;
+  ArrayBref *stack;
+  Uint level, maxlevel;
+  Makeitem *makeitem;
+  Subtreeresult<Item> *result;
+  bool operator()(Bref nodeptr) const
+  {
+    Subtreeresult<Item> *subtask;
+    Suffixtree *subtaskstree = stree;
+    Reference subtasknode;
+    Uint sublevel = level + 1, submaxlevel = maxlevel;
+    Makeitem submakeitem = *makeitem;
+
+    if(level >= maxlevel ||
+       branchingchildren(stree,stack->spaceBref[stack->nextfreeBref-1]) 
+       < UintConst(2))
+    {
+      return true;
+    }
+    subtask = new Subtreeresult<Item>;
+    result->splitpoints.push_back((Uint) result->items.size());
+    result->subtasks.push_back(subtask);
+    subtasknode.toleaf = false;
+    subtasknode.address = nodeptr;
+#pragma omp task firstprivate(subtaskstree,subtasknode,sublevel,submaxlevel,\
+                              submakeitem,subtask)
+    subtreetask<Item,Makeitem>(subtaskstree,subtasknode,sublevel,submaxlevel,
+                               submakeitem,subtask);
+    return false;
+  }
+};
+
+template<typename Item,typename Makeitem>
+static void subtreetask(Suffixtree *stree,Reference startnode,Uint level,
+                        Uint maxlevel,Makeitem makeitem,
+                        Subtreeresult<Item> *result)
+{
+  ArrayBref stack;
+  Subtreeleaf<Item,Makeitem> leaf = {&stack,&makeitem,result};
+  Subtreesplit<Item,Makeitem> split = {stree,&stack,level,maxlevel,
+                                       &makeitem,result};
+  Dfsnothing branch2;
+
+  INITARRAY(&stack,Bref);
+  (void) depthfirsttraversal(stree,&startnode,&stack,leaf,split,branch2);
+  FREEARRAY(&stack,Bref);
+}
+
+/*
+  The following function applies \texttt{consumeitem} to the items of
+  \texttt{result} and of its subtasks in depth first order, and frees
+  the results of the subtasks.
+*/
+
+template<typename Item,typename Consumeitem>
+static void mergesubtreeresult(Subtreeresult<Item> *result,
+                               Consumeitem &consumeitem)
+{
+  Uint i, subtask, itemnum = 0;
+
+  for(subtask = 0; subtask < (Uint) result->subtasks.size(); subtask++)
+  {
+    for(i = itemnum; i < result->splitpoints[subtask]; i++)
+    {
+      consumeitem(result->items[i]);
+    }
+    itemnum = result->splitpoints[subtask];
+    mergesubtreeresult(result->subtasks[subtask],consumeitem);
+    delete result->subtasks[subtask];
+  }
+  for(i = itemnum; i < (Uint) result->items.size(); i++)
+  {
+    consumeitem(result->items[i]);
+  }
+}
+
+template<typename Item,typename Makeitem,typename Consumeitem>
+void parallelsubtreeenumeration(Suffixtree *stree,Reference *startnode,
+                                Makeitem makeitem,Consumeitem consumeitem)
+{
+  Subtreeresult<Item> result;
+  Uint maxlevel = 0;
+
+  while((UintConst(1) << maxlevel) < (Uint) (32 * omp_get_max_threads()))
+  {
+    maxlevel++;
+  }
+#pragma omp parallel
+  {
+#pragma omp single
+    subtreetask<Item,Makeitem>(stree,*startnode,0,maxlevel,makeitem,&result);
+  }
+  mergesubtreeresult(&result,consumeitem);
+}
+
+#endif
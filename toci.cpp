@@ -23,6 +23,7 @@
 #include <omp.h>
 #include <papi.h>
 #include "types.h"
+#include "spacedef.h"
 #include "protodef.h"
 #include "errordef.h"
 #include "maxmatdef.h"
@@ -42,6 +43,8 @@ Sint parsemaxmatoptions (MMcallinfo *maxmatcallinfo,
                          int argc,
                          char **argv);
 
+void freequeryfilelist(MMcallinfo *mmcallinfo);
+
 /*EE
   The following function is imported form \texttt{maxmatinp.c}.
 */
@@ -49,6 +52,11 @@ Sint parsemaxmatoptions (MMcallinfo *maxmatcallinfo,
 Sint getmaxmatinput (Multiseq *subjectmultiseq,
                      bool matchnucleotidesonly,
                      char *subjectfile);
+Sint getshardedmaxmatinput (Multiseq *subjectmultiseq,
+                            Uint *shardstart,
+                            bool matchnucleotidesonly,
+                            char **shardfilelist,
+                            Uint numofshards);
 
 /*EE
   The following function is imported form \texttt{procmaxmat.c}.
@@ -82,9 +90,16 @@ int main(int argc, char *argv[])
         //MPI::Finalize();
         return EXIT_SUCCESS;
     }
+    setmempolicy(mmcallinfo.hugepages, mmcallinfo.numapolicy);
     /*if (rank == 0) {*/
         start = omp_get_wtime();
-        if (getmaxmatinput(&subjectmultiseq, mmcallinfo.matchnucleotidesonly, &mmcallinfo.subjectfile[0]) != 0) {
+        if (mmcallinfo.shards) {
+            mmcallinfo.shardstart = ALLOCSPACE(NULL,Uint,mmcallinfo.numofshards+1);
+            retcode = getshardedmaxmatinput(&subjectmultiseq, mmcallinfo.shardstart, mmcallinfo.matchnucleotidesonly, mmcallinfo.shardfilelist, mmcallinfo.numofshards);
+        } else {
+            retcode = getmaxmatinput(&subjectmultiseq, mmcallinfo.matchnucleotidesonly, &mmcallinfo.subjectfile[0]);
+        }
+        if (retcode != 0) {
             fprintf(stderr,"%s: %s\n",argv[0],messagespace());
             //MPI::Finalize();
             return EXIT_FAILURE;
@@ -95,6 +110,7 @@ int main(int argc, char *argv[])
             return EXIT_FAILURE;
         }
         freemultiseq(&subjectmultiseq);
+        FREESPACE(mmcallinfo.shardstart);
         //cerr << "# Toci application for genome alignment for HPC environments" << endl;
         finish = omp_get_wtime();
     /*else {